@@ -0,0 +1,127 @@
+#include <iostream> // for standard output
+#include <vector> // for vectors
+#include <cassert> // for assertions
+
+#include <eigen3/Eigen/Sparse> // sparse linear algebra library
+#include <eigen3/Eigen/IterativeLinearSolvers> // iterative linear solvers
+
+#include "methods.h"
+#include "dos_solver.h"
+
+using namespace std;
+
+void compute_dos_from_transitions_globally(network_simulation& ns) {
+  // start with the density of states we get by bootstrapping up through all energies,
+  //   which also identifies the entropy peak
+  ns.compute_dos_from_transitions();
+
+  // number of moves proposed from every energy
+  vector<long> moves_from(ns.energy_range);
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    moves_from[ee] = ns.transitions_from(ee);
+  }
+
+  // weight of the measurement of ln g(E_j) - ln g(E_i) from moves between E_i and E_j,
+  //   which is zero if we have not proposed enough moves in both directions
+  // note: the logarithm of a ratio of small counts is strongly biased (particularly if
+  //   we only keep the ratios for which both counts are nonzero), so we only use pairs
+  //   of energies between which we have proposed at least min_moves in each direction
+  const long min_moves = 100;
+  auto pair_weight = [&](const int ee, const int de) -> double {
+    const long forward_moves = ns.transitions(ee, de);
+    const long backward_moves = ns.transitions(ee + de, -de);
+    if (forward_moves < min_moves || backward_moves < min_moves) return 0;
+    return 1 / (1.0 / forward_moves + 1.0 / backward_moves);
+  };
+
+  // identify all energies connected to the entropy peak by pairs of moves,
+  //   and give each of them (except for the entropy peak itself) an index
+  //   in our system of equations
+  vector<int> index(ns.energy_range, -1);
+  vector<int> energies = { ns.entropy_peak };
+  vector<bool> connected(ns.energy_range, false);
+  connected[ns.entropy_peak] = true;
+  for (int ii = 0; ii < int(energies.size()); ii++) {
+    const int ee = energies[ii];
+    for (int de = -ns.max_de; de <= ns.max_de; de++) {
+      const int other_ee = ee + de;
+      if (de == 0 || other_ee < 0 || other_ee >= ns.energy_range) continue;
+      if (connected[other_ee] || pair_weight(ee, de) == 0) continue;
+      connected[other_ee] = true;
+      index[other_ee] = energies.size() - 1;
+      energies.push_back(other_ee);
+    }
+  }
+  const int unknowns = energies.size() - 1;
+  if (unknowns == 0) return;
+
+  // construct the normal equations L x = b for the weighted least squares problem,
+  //   in which L is a weighted graph laplacian, and the density of states at the
+  //   entropy peak is fixed to its current value
+  vector<Eigen::Triplet<double>> entries;
+  Eigen::VectorXd rhs = Eigen::VectorXd::Zero(unknowns);
+  Eigen::VectorXd guess(unknowns);
+  for (const int ee : energies) {
+    if (index[ee] >= 0) guess(index[ee]) = ns.ln_dos[ee];
+    for (int de = 1; de <= ns.max_de; de++) {
+      const int other_ee = ee + de;
+      if (other_ee >= ns.energy_range || !connected[other_ee]) continue;
+      const double weight = pair_weight(ee, de);
+      if (weight == 0) continue;
+
+      // the measured difference ln g(other_ee) - ln g(ee)
+      const double difference
+        = log(double(ns.transitions(ee, de)) / moves_from[ee]
+              / (double(ns.transitions(other_ee, -de)) / moves_from[other_ee]));
+
+      const int ii = index[ee];
+      const int jj = index[other_ee];
+      if (ii >= 0) {
+        entries.push_back(Eigen::Triplet<double>(ii, ii, weight));
+        rhs(ii) -= weight * difference;
+      } else {
+        rhs(jj) += weight * ns.ln_dos[ee];
+      }
+      if (jj >= 0) {
+        entries.push_back(Eigen::Triplet<double>(jj, jj, weight));
+        rhs(jj) += weight * difference;
+      } else {
+        rhs(ii) += weight * ns.ln_dos[other_ee];
+      }
+      if (ii >= 0 && jj >= 0) {
+        entries.push_back(Eigen::Triplet<double>(ii, jj, -weight));
+        entries.push_back(Eigen::Triplet<double>(jj, ii, -weight));
+      }
+    }
+  }
+  Eigen::SparseMatrix<double> laplacian(unknowns, unknowns);
+  laplacian.setFromTriplets(entries.begin(), entries.end());
+
+  // solve the normal equations, using both triangular halves of the (symmetric)
+  //   laplacian in matrix-vector products
+  Eigen::ConjugateGradient<Eigen::SparseMatrix<double>,
+                           Eigen::Lower|Eigen::Upper> solver;
+  solver.setTolerance(1e-10);
+  solver.compute(laplacian);
+  const Eigen::VectorXd solution = solver.solveWithGuess(rhs, guess);
+  if (solver.info() != Eigen::Success) {
+    cout << "global density of states solver did not converge;"
+         << " using the bootstrapped density of states" << endl;
+    return;
+  }
+
+  // update the density of states, and normalize it to 1 at the entropy peak
+  for (const int ee : energies) {
+    if (index[ee] >= 0) ns.ln_dos[ee] = solution(index[ee]);
+  }
+  double max_ln_dos = ns.ln_dos[ns.entropy_peak];
+  for (const int ee : energies) {
+    if (ns.ln_dos[ee] > max_ln_dos) {
+      max_ln_dos = ns.ln_dos[ee];
+      ns.entropy_peak = ee;
+    }
+  }
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    ns.ln_dos[ee] -= max_ln_dos;
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "methods.h"
+
+using namespace std;
+
+// compute the density of states of a simulation from its full transition histogram
+//   by a weighted least-squares fit of ln_dos to all detailed balance conditions
+// every pair of energies (E_i, E_j) between which we have proposed enough moves in both
+//   directions gives us a measurement of ln g(E_j) - ln g(E_i) = ln(T_{i->j}/T_{j->i}),
+//   where T_{i->j} is the (normalized) probability of proposing a move from E_i to E_j;
+//   we weight each measurement by the inverse of its (approximate) variance,
+//   1/n_{i->j} + 1/n_{j->i}, where n_{i->j} is the number of moves proposed from E_i
+//   to E_j, and solve the normal equations with a conjugate gradient method, using the
+//   density of states from compute_dos_from_transitions as a starting point and for
+//   any energies which are not connected to the entropy peak
+// note: this does not end initialization any sooner than a sweep (which decides how
+//   many cycles we run), but gives a more accurate final density of states
+void compute_dos_from_transitions_globally(network_simulation& ns);
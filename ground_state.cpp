@@ -0,0 +1,141 @@
+#include <iostream> // for standard output
+#include <random> // for randomness
+#include <cassert> // for assertions
+#include <algorithm> // for min and max
+#include <thread> // for multithreading
+
+#include "methods.h"
+#include "ground_state.h"
+
+using namespace std;
+
+const int ground_state_search::annealing_sweeps;
+constexpr double ground_state_search::initial_temp;
+constexpr double ground_state_search::final_temp;
+const int ground_state_search::tabu_moves_per_node;
+constexpr double ground_state_search::tabu_tenure;
+
+// run a given number of restarts in (at most) a given number of threads
+ground_state_search::ground_state_search(const hopfield_network& network,
+                                         const int restarts, const int threads,
+                                         const long seed) :
+  network(network)
+{
+  assert(restarts > 0 && threads > 0);
+  const int thread_number = min(threads, restarts);
+
+  // every thread runs every (thread_number)-th restart with its own random state,
+  //   and keeps track of the best state it has found
+  vector<vector<bool>> thread_states(thread_number);
+  vector<int> thread_energies(thread_number);
+  auto run_thread = [&](const int tt) {
+    seed_seq thread_seed = { seed, long(tt) };
+    mt19937_64 generator(thread_seed);
+    for (int rr = tt; rr < restarts; rr += thread_number) {
+      vector<bool> state;
+      int energy;
+      restart(generator, state, energy);
+      if (rr == tt || energy < thread_energies[tt]) {
+        thread_states[tt] = state;
+        thread_energies[tt] = energy;
+      }
+    }
+  };
+  vector<thread> search_threads;
+  for (int tt = 0; tt < thread_number; tt++) {
+    search_threads.push_back(thread(run_thread, tt));
+  }
+  for (thread& search_thread : search_threads) {
+    search_thread.join();
+  }
+
+  // collect the best state found by any thread
+  int best_thread = 0;
+  for (int tt = 1; tt < thread_number; tt++) {
+    if (thread_energies[tt] < thread_energies[best_thread]) best_thread = tt;
+  }
+  best_state = thread_states[best_thread];
+  best_energy = thread_energies[best_thread];
+}
+
+// run one restart, returning the lowest energy state we found and its energy
+void ground_state_search::restart(mt19937_64& generator,
+                                  vector<bool>& state, int& energy) const {
+  uniform_real_distribution<double> rnd;
+  const int nodes = network.nodes;
+
+  // start from a random state, with spins s_i in {-1, 1}, and compute its local fields
+  //   and (actual) energy -1/2 \sum_i s_i h_i
+  vector<int> spins(nodes);
+  for (int ii = 0; ii < nodes; ii++) {
+    spins[ii] = (rnd(generator) < 0.5) ? 1 : -1;
+  }
+  vector<int> fields(nodes, 0);
+  int current_energy = 0;
+  for (int ii = 0; ii < nodes; ii++) {
+    for (int jj = 0; jj < nodes; jj++) {
+      fields[ii] += network.couplings[ii][jj] * spins[jj];
+    }
+    current_energy -= spins[ii] * fields[ii];
+  }
+  current_energy /= 2;
+
+  vector<int> best_spins = spins;
+  int best_energy = current_energy;
+
+  // flip a node, updating the local fields, the current energy, and the best state
+  // flipping s_k changes the local field on every node i by -2 J_{ik} s_k
+  //   (but not the local field on node k itself, as J_{kk} = 0)
+  auto flip = [&](const int node) {
+    current_energy += 2 * spins[node] * fields[node];
+    const int change = - 2 * spins[node];
+    for (int jj = 0; jj < nodes; jj++) {
+      fields[jj] += change * network.couplings[jj][node];
+    }
+    spins[node] = -spins[node];
+    if (current_energy < best_energy) {
+      best_energy = current_energy;
+      best_spins = spins;
+    }
+  };
+
+  // anneal with a geometric temperature schedule
+  const long annealing_moves = long(annealing_sweeps) * nodes;
+  const double temp_ratio = pow(final_temp / initial_temp, 1.0 / annealing_moves);
+  double temp = initial_temp * network.max_energy_change;
+  for (long mm = 0; mm < annealing_moves; mm++, temp *= temp_ratio) {
+    const int node = floor(rnd(generator) * nodes);
+    const int energy_change = 2 * spins[node] * fields[node];
+    if (energy_change <= 0 || rnd(generator) < exp(-energy_change / temp)) {
+      flip(node);
+    }
+  }
+
+  // refine the annealed state with a tabu search: on every move, flip the node which
+  //   lowers the energy the most (or raises it the least), except for nodes which we
+  //   have flipped recently, unless flipping them takes us to a new best state
+  const int tenure = max(int(tabu_tenure * nodes), 1);
+  vector<long> tabu_until(nodes, 0);
+  const long tabu_moves = long(tabu_moves_per_node) * nodes;
+  for (long mm = 0; mm < tabu_moves; mm++) {
+    int best_node = -1;
+    int best_change = 0;
+    for (int ii = 0; ii < nodes; ii++) {
+      const int energy_change = 2 * spins[ii] * fields[ii];
+      if (tabu_until[ii] > mm && current_energy + energy_change >= best_energy) continue;
+      if (best_node < 0 || energy_change < best_change) {
+        best_node = ii;
+        best_change = energy_change;
+      }
+    }
+    if (best_node < 0) continue;
+    flip(best_node);
+    tabu_until[best_node] = mm + tenure;
+  }
+
+  state = vector<bool>(nodes);
+  for (int ii = 0; ii < nodes; ii++) {
+    state[ii] = (best_spins[ii] > 0);
+  }
+  energy = best_energy;
+}
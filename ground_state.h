@@ -0,0 +1,37 @@
+#pragma once
+
+#include <random> // for randomness
+
+#include "methods.h"
+
+using namespace std;
+
+// search for the ground state of a network by simulated annealing followed by a tabu
+//   search, restarted from a number of random states which are split between threads
+// both stages keep track of the local fields h_i = \sum_j J_{ij} s_j on all nodes,
+//   from which the energy change from flipping node i is 2 s_i h_i
+struct ground_state_search {
+
+  // number of sweeps (i.e. moves per node) in every annealing run, initial and final
+  //   annealing temperatures in units of the largest possible energy change in one move,
+  //   number of tabu search moves per node, and the tabu tenure in units of nodes
+  static const int annealing_sweeps = 100;
+  static constexpr double initial_temp = 0.1;
+  static constexpr double final_temp = 0.001;
+  static const int tabu_moves_per_node = 20;
+  static constexpr double tabu_tenure = 0.1;
+
+  const hopfield_network& network;
+
+  // lowest energy state we have found, and its (actual) energy
+  vector<bool> best_state;
+  int best_energy;
+
+  // constructor: run a given number of restarts in (at most) a given number of threads
+  ground_state_search(const hopfield_network& network, const int restarts,
+                      const int threads, const long seed);
+
+  // run one restart, returning the lowest energy state we found and its energy
+  void restart(mt19937_64& generator, vector<bool>& state, int& energy) const;
+
+};
@@ -4,6 +4,10 @@
 #include <sstream> // for string streams
 #include <algorithm> // for sort method
 #include <fstream> // for stream objects
+#include <functional> // for function objects
+#include <cassert> // for assertions
+
+#include <eigen3/Eigen/Dense> // dense linear algebra library
 
 #include "methods.h"
 
@@ -36,8 +40,47 @@ vector<bool> random_state(const int nodes, uniform_real_distribution<double>& rn
   return state;
 }
 
+// integrated autocorrelation time of a series of measurements
+double autocorrelation_time(const vector<double>& series) {
+  const long size = series.size();
+  if (size < 2) return 0;
+  double mean = 0;
+  for (const double value : series) mean += value;
+  mean /= size;
+  double variance = 0;
+  for (const double value : series) variance += (value - mean) * (value - mean);
+  variance /= size;
+  if (variance == 0) return 0;
+
+  // the variance of the means of blocks of b measurements is 2 tau variance / b for
+  //   b >> tau, so we double the block size until it is at least twenty times the
+  //   autocorrelation time estimated from it (keeping at least 100 blocks)
+  double tau = 0.5;
+  for (long block_size = 1; size / block_size >= 100; block_size *= 2) {
+    const long blocks = size / block_size;
+    double block_variance = 0;
+    for (long bb = 0; bb < blocks; bb++) {
+      double block_mean = 0;
+      for (long ii = bb * block_size; ii < (bb + 1) * block_size; ii++) {
+        block_mean += series[ii];
+      }
+      block_mean /= block_size;
+      block_variance += (block_mean - mean) * (block_mean - mean);
+    }
+    block_variance /= blocks;
+    tau = block_size * block_variance / (2 * variance);
+    if (block_size >= 20 * tau) break;
+  }
+  return tau;
+}
+
+// definitions of static constants, which are needed when they are passed by reference
+const int hopfield_network::coupling_block_size;
+
 // hopfield network constructor
-hopfield_network::hopfield_network(const vector<vector<bool>>& patterns) {
+hopfield_network::hopfield_network(const vector<vector<bool>>& patterns) :
+  patterns(patterns)
+{
   // number of nodes in network
   nodes = patterns[0].size();
 
@@ -54,6 +97,38 @@ hopfield_network::hopfield_network(const vector<vector<bool>>& patterns) {
     }
   }
 
+  compute_energy_data();
+};
+
+// add a pattern to the network
+void hopfield_network::add_pattern(const vector<bool>& pattern) {
+  assert(int(pattern.size()) == nodes);
+  update_couplings(pattern, 1);
+  patterns.push_back(pattern);
+  compute_energy_data();
+}
+
+// remove a pattern from the network
+void hopfield_network::remove_pattern(const int pattern) {
+  assert(pattern >= 0 && pattern < int(patterns.size()) && patterns.size() > 1);
+  update_couplings(patterns[pattern], -1);
+  patterns.erase(patterns.begin() + pattern);
+  compute_energy_data();
+}
+
+// add (sign = 1) or subtract (sign = -1) the couplings x_i x_j of a pattern x
+void hopfield_network::update_couplings(const vector<bool>& pattern, const int sign) {
+  for (int ii = 0; ii < nodes; ii++) {
+    for (int jj = 0; jj < nodes; jj++) {
+      if (jj == ii) continue;
+      couplings[ii][jj] += sign * (2 * (pattern[ii] == pattern[jj]) - 1);
+    }
+  }
+}
+
+// compute the energy scale, bounds, and maximum energy change of the network,
+//   as well as the bounds on its coupling rows used for early rejection of node flips
+void hopfield_network::compute_energy_data() {
   // determine the maximum energy change possible in one move
   max_energy_change = 0;
   energy_scale = 0;
@@ -68,22 +143,81 @@ hopfield_network::hopfield_network(const vector<vector<bool>>& patterns) {
     energy_scale = gcd(node_resolution, energy_scale);
   }
 
-  // compute an upper bound on the maximum energy achievable by network
   // given that the actual energy is
-  //   1/2 \sum_{i,j} J_{ij} s_i s_j with s_i, s_j in {-1, 1}
-  //   an upper bound is 1/2 \sum_{i,j} |J_{ij}| = \sum_{i,j>i} |J_{ij}|
-  max_energy = 0;
+  //   -1/2 \sum_{i,j} J_{ij} s_i s_j with s_i, s_j in {-1, 1},
+  //   a simple bound on its magnitude is 1/2 \sum_{i,j} |J_{ij}| = \sum_{i,j>i} |J_{ij}|
+  int coupling_bound = 0;
   for (int ii = 0; ii < nodes; ii++) {
     for (int jj = ii + 1; jj < nodes; jj++) {
-      max_energy += abs(couplings[ii][jj]);
+      coupling_bound += abs(couplings[ii][jj]);
     }
   }
-  // fix up max_energy so that for any energy E we observe,
-  //   (E + max_energy) is divisible by energy_scale
-  const int offset = (max_energy + energy(patterns[0])) % energy_scale;
-  max_energy += (energy_scale - offset) % energy_scale;
 
-};
+  // in terms of the overlaps m_p = \sum_i x^p_i s_i of a state with the patterns,
+  //   the energy is -1/2 (\sum_p m_p^2 - P N), where \sum_p m_p^2 = s^T X^T X s
+  //   for the (P x N) matrix of patterns X, so \sum_p m_p^2 / N lies between the
+  //   smallest and largest eigenvalues of X^T X
+  // the nonzero eigenvalues of X^T X are those of the (P x P) pattern overlap matrix
+  //   X X^T, and X^T X has at least N - P zero eigenvalues
+  const int pattern_number = patterns.size();
+  Eigen::MatrixXd pattern_overlaps(pattern_number, pattern_number);
+  for (int pp = 0; pp < pattern_number; pp++) {
+    for (int qq = 0; qq < pattern_number; qq++) {
+      int overlap = 0;
+      for (int ii = 0; ii < nodes; ii++) {
+        overlap += 2 * (patterns[pp][ii] == patterns[qq][ii]) - 1;
+      }
+      pattern_overlaps(pp, qq) = overlap;
+    }
+  }
+  const Eigen::VectorXd overlap_spectrum // in increasing order
+    = Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd>(pattern_overlaps,
+                                                     Eigen::EigenvaluesOnly).eigenvalues();
+  const double largest_eigenvalue = overlap_spectrum(pattern_number - 1);
+  const double smallest_eigenvalue
+    = (pattern_number < nodes ? 0 : max(overlap_spectrum(pattern_number - nodes), 0.));
+
+  // bound the energy by the tighter of the two bounds on either side,
+  //   leaving some room for numerical error in the eigenvalues
+  const double tolerance = 1e-6 * pattern_number * nodes + 1;
+  const int spectral_min_energy
+    = floor(-(largest_eigenvalue - pattern_number) * nodes / 2 - tolerance);
+  const int spectral_max_energy
+    = ceil(-(smallest_eigenvalue - pattern_number) * nodes / 2 + tolerance);
+  const int lowest_energy = max(-coupling_bound, spectral_min_energy);
+  const int highest_energy = min(coupling_bound, spectral_max_energy);
+
+  // fix up both bounds so that for any energy E we observe,
+  //   (E - min_energy) is divisible by energy_scale,
+  //   using the energy of the first pattern as a reference
+  int pattern_energy = pattern_number * nodes;
+  for (int pp = 0; pp < pattern_number; pp++) {
+    pattern_energy -= int(pattern_overlaps(0, pp) * pattern_overlaps(0, pp));
+  }
+  pattern_energy /= 2;
+  min_energy = (pattern_energy
+                - energy_scale * ((pattern_energy - lowest_energy + energy_scale - 1)
+                                  / energy_scale));
+  max_energy = (pattern_energy
+                + energy_scale * ((highest_energy - pattern_energy) / energy_scale));
+  assert(energy(patterns[0]) * energy_scale + min_energy == pattern_energy);
+
+  // bound the contribution to a node's energy from the couplings in each row
+  //   past the start of every block, for early rejection of node flips
+  const int blocks = (nodes + coupling_block_size - 1) / coupling_block_size;
+  coupling_tail_bounds = vector<vector<int>>(nodes);
+  for (int ii = 0; ii < nodes; ii++) {
+    coupling_tail_bounds[ii] = vector<int>(blocks + 1, 0);
+    for (int bb = blocks - 1; bb >= 0; bb--) {
+      int block_bound = 0;
+      for (int jj = bb * coupling_block_size;
+           jj < min((bb + 1) * coupling_block_size, nodes); jj++) {
+        block_bound += abs(couplings[ii][jj]);
+      }
+      coupling_tail_bounds[ii][bb] = coupling_tail_bounds[ii][bb+1] + block_bound;
+    }
+  }
+}
 
 // (index of) energy of the network in a given state
 int hopfield_network::energy(const vector<bool>& state) const {
@@ -94,12 +228,15 @@ int hopfield_network::energy(const vector<bool>& state) const {
       energy -= couplings[ii][jj] * (2 * (node_state == state[jj]) - 1);
     }
   }
-  return (energy + max_energy) / energy_scale;
+  return (energy - min_energy) / energy_scale;
 }
 
-// convert energy index to an "actual" energy
+// convert between energy indices and "actual" energies
+int hopfield_network::energy_index(const int actual_energy) const {
+  return (actual_energy - min_energy) / energy_scale;
+}
 int hopfield_network::actual_energy(const int energy_index) const {
-  return energy_index * energy_scale - max_energy;
+  return energy_index * energy_scale + min_energy;
 }
 
 // print coupling matrix
@@ -126,17 +263,41 @@ void hopfield_network::print_couplings() const {
 }
 
 // network simulation constructor
+// index of the lowest (if round_up is true) or highest energy of a network which lies
+//   on a given side of an (actual) energy, clamped to the range of energies of the network
+static int bounding_energy_index(const hopfield_network& network, const int actual_energy,
+                                 const bool round_up) {
+  const int full_range = (network.max_energy - network.min_energy)/network.energy_scale + 1;
+  const double index = (double(actual_energy) - network.min_energy) / network.energy_scale;
+  const double bound = round_up ? ceil(index) : floor(index);
+  return int(min(max(bound, 0.), double(full_range - 1)));
+}
+
 network_simulation::network_simulation(const vector<vector<bool>>& patterns,
                                        const vector<bool>& initial_state,
-                                       const bool fixed_temp) :
+                                       const bool fixed_temp,
+                                       const int lowest_energy,
+                                       const int highest_energy) :
+  network_simulation(hopfield_network(patterns), initial_state, fixed_temp,
+                     lowest_energy, highest_energy)
+{};
+
+network_simulation::network_simulation(const hopfield_network& network,
+                                       const vector<bool>& initial_state,
+                                       const bool fixed_temp,
+                                       const int lowest_energy,
+                                       const int highest_energy) :
   fixed_temp(fixed_temp),
-  patterns(patterns),
-  pattern_number(patterns.size()),
-  network(hopfield_network(patterns)),
-  energy_range(2*network.max_energy/network.energy_scale),
+  patterns(network.patterns),
+  pattern_number(network.patterns.size()),
+  network(network),
+  window_offset(bounding_energy_index(network, lowest_energy, true)),
+  energy_range(bounding_energy_index(network, highest_energy, false) - window_offset + 1),
   max_de(network.max_energy_change/network.energy_scale)
 {
-  entropy_peak = energy_range / 2; // an initial guess
+  assert(energy_range > 0);
+  // an initial guess for the entropy peak: the energy E = 0
+  entropy_peak = min(max(energy_index(0), 0), energy_range - 1);
   state = initial_state;
   initialize_histograms();
   if (!fixed_temp) {
@@ -162,6 +323,20 @@ long network_simulation::transitions_from(const int energy) const {
   return count;
 }
 
+// number of attempted transitions from a given energy bin with a specified change in bin
+long network_simulation::bin_transitions(const int bin, const int bin_change) const {
+  return bin_transition_histogram[bin][bin_change + max_bin_de];
+}
+
+// number of attempted transitions from a given energy bin into any other bin
+long network_simulation::bin_transitions_from(const int bin) const {
+  long count = 0;
+  for (int db = -max_bin_de; db <= max_bin_de; db++) {
+    count += bin_transitions(bin, db);
+  }
+  return count;
+}
+
 // elements of the actual normalized transition matrix:
 //   the probability of moving from a given initial energy into a specific final energy
 double network_simulation::transition_matrix(const int final_energy,
@@ -184,7 +359,8 @@ double network_simulation::transition_matrix(const int final_energy,
 // ---------------------------------------------------------------------------------------
 
 // compute energy change due to flipping a node from its current state
-int network_simulation::node_flip_energy_change(const int node) const {
+int network_simulation::node_flip_energy_change(const vector<bool>& state,
+                                                const int node) const {
   const bool node_state = state[node];
   int node_energy = 0;
   for (int ii = 0; ii < network.nodes; ii++) {
@@ -193,6 +369,123 @@ int network_simulation::node_flip_energy_change(const int node) const {
   return - 2 * node_energy / network.energy_scale;
 }
 
+// compute energy change due to flipping a node in a fixed temperature simulation,
+//   giving up early (and returning false) if we can prove that the move would fail
+//   a metropolis test against the (already drawn) random number acceptance_draw
+bool network_simulation::node_flip_energy_change(const vector<bool>& state,
+                                                 const int node, const double temp,
+                                                 const double acceptance_draw,
+                                                 int& energy_change) const {
+  // a move with energy change de passes the metropolis test if
+  //   acceptance_draw < exp(-de/temp), i.e. if sign(temp) * de < max_signed_change
+  // we give up only when sign(temp) * de provably exceeds this threshold by a margin,
+  //   so that the final decision is always made by the regular metropolis test
+  const int sign = (temp > 0) ? 1 : -1;
+  const double max_signed_change = - abs(temp) * log(acceptance_draw) + 1;
+
+  const bool node_state = state[node];
+  const vector<int>& couplings = network.couplings[node];
+  const vector<int>& tail_bounds = network.coupling_tail_bounds[node];
+  int node_energy = 0;
+  for (int bb = 0, block_start = 0; block_start < network.nodes;
+       bb++, block_start += hopfield_network::coupling_block_size) {
+    const int block_end = min(block_start + hopfield_network::coupling_block_size,
+                              network.nodes);
+    for (int ii = block_start; ii < block_end; ii++) {
+      node_energy -= couplings[ii] * (2 * (node_state == state[ii]) - 1);
+    }
+    // the remaining couplings can lower sign * node_energy by at most tail_bounds[bb+1]
+    const int min_signed_change = (2 * (- sign * node_energy - tail_bounds[bb+1])
+                                   / network.energy_scale);
+    if (min_signed_change > max_signed_change) return false;
+  }
+  energy_change = - 2 * node_energy / network.energy_scale;
+  return true;
+}
+
+// propose a pattern-directed move from a given state
+bool network_simulation::propose_pattern_move(const vector<bool>& state,
+                                              uniform_real_distribution<double>& rnd,
+                                              mt19937_64& generator, vector<int>& flips,
+                                              int& energy_change,
+                                              double& ln_proposal_ratio) const {
+  const int nodes = network.nodes;
+
+  // pick a target, and collect the nodes on which we disagree with it
+  const int target = floor(rnd(generator) * 2 * pattern_number);
+  const int target_pattern = target / 2;
+  const bool inverse_target = target % 2;
+  vector<int> disagreements;
+  for (int ii = 0; ii < nodes; ii++) {
+    if ((state[ii] != patterns[target_pattern][ii]) != inverse_target) {
+      disagreements.push_back(ii);
+    }
+  }
+  if (disagreements.empty()) return false;
+
+  // pick the number of nodes to flip, and choose them with a partial shuffle
+  const int flip_number = 1 + floor(rnd(generator) * disagreements.size());
+  for (int kk = 0; kk < flip_number; kk++) {
+    const int choice = kk + floor(rnd(generator) * (disagreements.size() - kk));
+    swap(disagreements[kk], disagreements[choice]);
+  }
+  flips = vector<int>(disagreements.begin(), disagreements.begin() + flip_number);
+
+  // flipping a set S of spins s_i in {-1, 1} changes the (actual) energy
+  //   -1/2 \sum_{ij} J_{ij} s_i s_j by 2 \sum_{i in S} \sum_{j not in S} J_{ij} s_i s_j
+  vector<bool> flipped(nodes, false);
+  for (const int node : flips) flipped[node] = true;
+  int actual_energy_change = 0;
+  for (const int node : flips) {
+    for (int jj = 0; jj < nodes; jj++) {
+      if (flipped[jj]) continue;
+      actual_energy_change
+        += 2 * network.couplings[node][jj] * (2 * (state[node] == state[jj]) - 1);
+    }
+  }
+  energy_change = actual_energy_change / network.energy_scale;
+
+  // the same set of nodes S may be proposed with any target whose disagreements with
+  //   the state include all of S, so the probability of proposing S is
+  //   \sum_{targets} [S in disagreements] / (2 * pattern_number) / d / binomial(d, k)
+  // if S contains s of the d disagreements with a pattern before the move, then after
+  //   the move it contains k - s of the d - s + (k - s) disagreements with the pattern,
+  //   and the complements of these sets for the inverse of the pattern
+  auto ln_probability = [&](const int disagreement_number) -> double {
+    return (- log(disagreement_number) - lgamma(disagreement_number + 1)
+            + lgamma(flip_number + 1) + lgamma(disagreement_number - flip_number + 1));
+  };
+  vector<double> ln_forward;
+  vector<double> ln_reverse;
+  for (int pp = 0; pp < pattern_number; pp++) {
+    int disagreement_number = 0;
+    int flipped_disagreements = 0;
+    for (int ii = 0; ii < nodes; ii++) {
+      const bool disagreement = (state[ii] != patterns[pp][ii]);
+      disagreement_number += disagreement;
+      flipped_disagreements += (disagreement && flipped[ii]);
+    }
+    const int new_disagreement_number
+      = disagreement_number - 2 * flipped_disagreements + flip_number;
+    if (flipped_disagreements == flip_number) {
+      ln_forward.push_back(ln_probability(disagreement_number));
+      ln_reverse.push_back(ln_probability(nodes - new_disagreement_number));
+    }
+    if (flipped_disagreements == 0) {
+      ln_forward.push_back(ln_probability(nodes - disagreement_number));
+      ln_reverse.push_back(ln_probability(new_disagreement_number));
+    }
+  }
+  auto ln_sum = [](const vector<double>& ln_terms) -> double {
+    const double max_ln_term = *max_element(ln_terms.begin(), ln_terms.end());
+    double term_sum = 0;
+    for (const double ln_term : ln_terms) term_sum += exp(ln_term - max_ln_term);
+    return max_ln_term + log(term_sum);
+  };
+  ln_proposal_ratio = ln_sum(ln_reverse) - ln_sum(ln_forward);
+  return true;
+}
+
 // probability to accept a move
 double network_simulation::move_probability(const int current_energy,
                                             const int energy_change,
@@ -225,6 +518,31 @@ void network_simulation::initialize_histograms() {
   }
 }
 
+// set the width of the energy bins used by the initialization routine,
+//   and collect the transitions between bins from the transition histogram
+// a move by de from the energy ee changes the bin by at most ceil(max_de / width)
+void network_simulation::set_bin_width(const int width) {
+  assert(width > 0);
+  bin_width = width;
+  bin_range = (energy_range + width - 1) / width;
+  max_bin_de = (max_de + width - 1) / width;
+  if (width == 1) {
+    bin_transition_histogram.clear();
+    return;
+  }
+  bin_transition_histogram = vector<vector<long>>(bin_range,
+                                                  vector<long>(2*max_bin_de + 1, 0));
+  for (int ee = 0; ee < energy_range; ee++) {
+    const int bin = ee / width;
+    for (int de = -max_de; de <= max_de; de++) {
+      const long count = transition_histogram[ee][de + max_de];
+      if (count == 0) continue;
+      const int proposed_bin = floor(double(ee + de) / width);
+      bin_transition_histogram[bin][proposed_bin - bin + max_bin_de] += count;
+    }
+  }
+}
+
 void network_simulation::update_distance_logs(const int energy) {
   int min_distance = network.nodes;
   // for each pattern pp
@@ -301,11 +619,231 @@ void network_simulation::update_sample_histogram(const int new_energy,
 void network_simulation::update_transition_histogram(const int energy,
                                                      const int energy_change) {
   transition_histogram[energy][energy_change + max_de]++;
+  if (bin_width > 1) {
+    const int bin = energy / bin_width;
+    // note: moves out of the energy window go to "bins" outside of the bin range,
+    //   which only enter the normalization of transitions from this bin
+    const int proposed_bin = floor(double(energy + energy_change) / bin_width);
+    bin_transition_histogram[bin][proposed_bin - bin + max_bin_de]++;
+  }
+}
+
+// probability to accept a move during the all-temperature initialization routine
+// in order to get good statistics on the transition matrix,
+//   we wish to sample all energies as equally as we can
+// if the forward flux F_{i->f} of proposed moves from E_i to E_f is,
+//   say, twice the backwards flux F_{f->i}, then to sample E_i and E_f
+//   equally we should reject half of the proposed moves from E_i to E_f
+// in general, the move probability necessary to sample E_i and E_f equally
+//   is F_{f->i} / F_{i->f} (see: detailed balance)
+// if we work with energy bins, we use the fluxes between the bins of E_i and E_f,
+//   which means that we accept all moves within a bin
+double network_simulation::init_move_probability(const int current_energy,
+                                                 const int energy_change,
+                                                 const double temp) const {
+  const int proposed_energy = current_energy + energy_change;
+
+  // compute the (unnormalized) flux of proposed moves forward and backward
+  //   between the current and proposed energies (or bins),
+  //   and normalization factors for both transition fluxes
+  double backward_moves, forward_moves, backward_norm, forward_norm;
+  if (bin_width == 1) {
+    backward_moves = transitions(proposed_energy, -energy_change);
+    forward_moves = transitions(current_energy, energy_change);
+    backward_norm = transitions_from(proposed_energy);
+    forward_norm = transitions_from(current_energy);
+  } else {
+    const int bin = current_energy / bin_width;
+    const int proposed_bin = proposed_energy / bin_width;
+    backward_moves = bin_transitions(proposed_bin, bin - proposed_bin);
+    forward_moves = bin_transitions(bin, proposed_bin - bin);
+    backward_norm = bin_transitions_from(proposed_bin);
+    forward_norm = bin_transitions_from(bin);
+  }
+
+  // boltzmann factor of this move at the minimum temperature of the simulation
+  //   (with two-sided weights, at the minimum magnitude of temperature on either side)
+  const double boltzmann_floor = (two_sided ? exp(-abs(energy_change) / abs(temp)) :
+                                  exp(-energy_change / temp));
+
+  // if we have never made the backward transition f->i, accept this move, unless
+  //   we have an a priori estimate of the density of states, in which case we accept it
+  //   with the probability that would sample E_i and E_f equally according to this
+  //   estimate (but no less than at the minimum temperature of the simulation)
+  if (backward_moves == 0) {
+    if (ln_dos_estimate.empty()) return 1;
+    return max(exp(ln_dos_estimate[current_energy] - ln_dos_estimate[proposed_energy]),
+               boltzmann_floor);
+  }
+
+  // compute the flux ratio F_{f->i} / F_{i->f}
+  const double flux_ratio = ((backward_moves * forward_norm)
+                             / (forward_moves * backward_norm));
+
+  // enforce a minimum acceptance probability based on:
+  //  i) how many times we have tried to make the backward move f->i;
+  //     if we have barely ever tried to move f->i, we want to be more likely
+  //     to move into E_f to gather more statistics on transitions out of it
+  // ii) the ratio of boltzmann weights on E_i and E_f at the minimum
+  //     temperature of the simulation; otherwise, we would be wasting our
+  //     time oversampling E_i relative to E_f
+  const double sample_floor = 1.0/backward_moves;
+  const double min_probability = max(sample_floor, boltzmann_floor);
+
+  return max(flux_ratio, min_probability);
+}
+
+// walk from the current state into the window of energies we simulate
+bool network_simulation::enter_window(const long max_moves, const double temp,
+                                      uniform_real_distribution<double>& rnd,
+                                      mt19937_64& generator) {
+  auto distance = [&](const int energy) -> int {
+    return max({-energy, energy - (energy_range - 1), 0});
+  };
+  int current_energy = energy();
+  for (long mm = 0; mm < max_moves && distance(current_energy) > 0; mm++) {
+    const int node = floor(rnd(generator) * network.nodes);
+    const int energy_change = node_flip_energy_change(node);
+    const int distance_change = (distance(current_energy + energy_change)
+                                 - distance(current_energy));
+    if (distance_change <= 0 || rnd(generator) < exp(-distance_change / abs(temp))) {
+      state[node] = !state[node];
+      current_energy += energy_change;
+    }
+  }
+  return in_window(current_energy);
+}
+
+// run one cycle of the all-temperature initialization routine from the current state
+void network_simulation::init_cycle(const long moves, const double temp,
+                                    uniform_real_distribution<double>& rnd,
+                                    mt19937_64& generator) {
+  int new_energy; // energy of the new state after every move
+  int old_energy = energy(); // energy of the network state before the last move
+  assert(in_window(old_energy));
+
+  for (long ii = 0; ii < moves; ii++) {
+
+    // pick a random node to possibly flip,
+    //   and compute the change in energy from flipping it
+    const int node = floor(rnd(generator) * network.nodes);
+    const int energy_change = node_flip_energy_change(node);
+    const int proposed_energy = old_energy + energy_change;
+    assert(abs(energy_change) <= max_de);
+
+    // the transition histogram contains information about proposed moves, not
+    //   accepted moves, so we sample it always (even if the move is later rejected)
+    update_transition_histogram(old_energy, energy_change);
+
+    // always accept moves to a lower (higher) energy in a positive (negative)
+    //   temperature simulation, and otherwise accept moves with a probability
+    //   determined by the transition histogram
+    // if we want two-sided weights, we instead always accept moves away from the entropy
+    //   peak (i.e. toward either tail of the density of states)
+    const bool always_accept = (two_sided ?
+                                ((old_energy <= entropy_peak && energy_change <= 0) ||
+                                 (old_energy >= entropy_peak && energy_change >= 0)) :
+                                ((temp > 0 && energy_change <= 0) ||
+                                 (temp < 0 && energy_change >= 0)));
+    // moves out of the energy window are always rejected
+    if (in_window(proposed_energy) &&
+        (always_accept ||
+         rnd(generator) < init_move_probability(old_energy, energy_change, temp))) {
+      state[node] = !state[node];
+      new_energy = proposed_energy;
+    } else {
+      // otherwise reject it
+      new_energy = old_energy;
+    }
+
+    assert(in_window(new_energy));
+
+    // update the energy and sample histograms
+    // we don't care about other histograms during initialization
+    energy_histogram[new_energy]++;
+    update_sample_histogram(new_energy, old_energy);
+
+    // as we move on with our lives (and this loop) the new energy turns old
+    old_energy = new_energy;
+  }
+}
+
+// merge the histograms recorded by copies of this simulation (i.e. shards), all of
+//   which started the last initialization cycle with the same histograms as this one,
+//   and bring all shards up to date with the merged histograms
+// note: every shard keeps its own state and visit log
+
+// add the counts recorded by every shard since the last merge to a histogram,
+//   and copy the result into the shards
+template <typename T>
+void merge_shard_histograms(vector<T>& histogram, vector<network_simulation>& shards,
+                            const function<vector<T>&(network_simulation&)>&
+                            shard_histogram) {
+  // most rows of the transition histogram are only visited by some (if any) shards
+  //   in a given cycle, so we skip histograms which no shard has added to
+  bool changed = false;
+  for (network_simulation& shard : shards) {
+    if (shard_histogram(shard) != histogram) {
+      changed = true;
+      break;
+    }
+  }
+  if (!changed) return;
+  const vector<T> old_histogram = histogram;
+  for (network_simulation& shard : shards) {
+    const vector<T>& shard_counts = shard_histogram(shard);
+    for (int ii = 0, size = histogram.size(); ii < size; ii++) {
+      histogram[ii] += shard_counts[ii] - old_histogram[ii];
+    }
+  }
+  for (network_simulation& shard : shards) {
+    shard_histogram(shard) = histogram;
+  }
+}
+
+void network_simulation::merge_init_shards(vector<network_simulation>& shards) {
+  for (int ee = 0; ee < energy_range; ee++) {
+    merge_shard_histograms<long>(transition_histogram[ee], shards,
+                                 [&](network_simulation& shard) -> vector<long>& {
+                                   return shard.transition_histogram[ee];
+                                 });
+  }
+  for (int bb = 0; bin_width > 1 && bb < bin_range; bb++) {
+    merge_shard_histograms<long>(bin_transition_histogram[bb], shards,
+                                 [&](network_simulation& shard) -> vector<long>& {
+                                   return shard.bin_transition_histogram[bb];
+                                 });
+  }
+  merge_shard_histograms<long>(energy_histogram, shards,
+                               [](network_simulation& shard) -> vector<long>& {
+                                 return shard.energy_histogram;
+                               });
+  merge_shard_histograms<long>(sample_histogram, shards,
+                               [](network_simulation& shard) -> vector<long>& {
+                                 return shard.sample_histogram;
+                               });
 }
 
 // compute density of states from the transition matrix
 void network_simulation::compute_dos_from_transitions() {
 
+  // number of moves proposed from every energy, which normalizes the transition matrix
+  // note: we count these once up front rather than in every call to transition_matrix,
+  //   which would make every sweep quadratic in max_de, and the sweep is the serial
+  //   part of an initialization cycle
+  vector<long> moves_from(energy_range);
+  for (int ee = 0; ee < energy_range; ee++) {
+    moves_from[ee] = transitions_from(ee);
+  }
+
+  // elements of the normalized transition matrix between energies at most max_de apart
+  //   (see transition_matrix)
+  auto normalized_transitions = [&](const int final_ee, const int initial_ee) -> double {
+    if (moves_from[initial_ee] == 0) return 0;
+    return (double(transitions(initial_ee, final_ee - initial_ee))
+            / moves_from[initial_ee]);
+  };
+
   // keep track of the maximal value of ln_dos
   double max_ln_dos = 0;
 
@@ -334,8 +872,8 @@ void network_simulation::compute_dos_from_transitions() {
       // as we will actually be interested in the ratio of these fluxes,
       //   multiplying them both by a constant factor has no consequence
       flux_up_to_this_energy += (exp(ln_dos[smaller_ee] - ln_dos[ee])
-                                 * transition_matrix(ee, smaller_ee));
-      flux_down_from_this_energy += transition_matrix(smaller_ee, ee);
+                                 * normalized_transitions(ee, smaller_ee));
+      flux_down_from_this_energy += normalized_transitions(smaller_ee, ee);
     }
 
     // in an equilibrium ensemble of simulations, the two fluxes we computed above
@@ -364,6 +902,135 @@ void network_simulation::compute_dos_from_transitions() {
 
 }
 
+// compute density of states from the transition matrix between energy bins
+// we bootstrap the density of states of the bins exactly as we do for energies in
+//   compute_dos_from_transitions, and then interpolate ln_dos linearly between the
+//   centers of the bins (up to a constant offset of ln(bin_width), which drops out
+//   when we normalize the density of states)
+void network_simulation::compute_dos_from_bin_transitions() {
+  assert(bin_width > 1);
+
+  // number of times we have seen every bin
+  vector<long> bin_histogram(bin_range, 0);
+  for (int ee = 0; ee < energy_range; ee++) {
+    bin_histogram[ee / bin_width] += energy_histogram[ee];
+  }
+
+  // number of moves proposed from every bin, and the probability of proposing a move
+  //   from one bin into another
+  vector<long> moves_from(bin_range);
+  for (int bb = 0; bb < bin_range; bb++) {
+    moves_from[bb] = bin_transitions_from(bb);
+  }
+  auto bin_transition_matrix = [&](const int final_bin, const int initial_bin) -> double {
+    if (moves_from[initial_bin] == 0) return 0;
+    return (double(bin_transitions(initial_bin, final_bin - initial_bin))
+            / moves_from[initial_bin]);
+  };
+
+  // sweep up through all bins to bootstrap their density of states
+  vector<double> ln_bin_dos(bin_range, 0);
+  for (int bb = 1; bb < bin_range; bb++) {
+    ln_bin_dos[bb] = ln_bin_dos[bb-1];
+    if (bin_histogram[bb] < max_bin_de) continue;
+    double flux_up_to_this_bin = 0;
+    double flux_down_from_this_bin = 0;
+    for (int smaller_bb = max(bb - max_bin_de, 0); smaller_bb < bb; smaller_bb++) {
+      flux_up_to_this_bin += (exp(ln_bin_dos[smaller_bb] - ln_bin_dos[bb])
+                              * bin_transition_matrix(bb, smaller_bb));
+      flux_down_from_this_bin += bin_transition_matrix(smaller_bb, bb);
+    }
+    if (flux_up_to_this_bin > 0 && flux_down_from_this_bin > 0) {
+      ln_bin_dos[bb] += log(flux_up_to_this_bin/flux_down_from_this_bin);
+    }
+  }
+
+  // interpolate the density of states of every energy from that of its neighboring bins,
+  //   and locate the entropy peak
+  double max_ln_dos = -numeric_limits<double>::infinity();
+  for (int ee = 0; ee < energy_range; ee++) {
+    const double position = (ee + 0.5) / bin_width - 0.5; // in units of bins
+    const int bin = min(max(int(floor(position)), 0), bin_range - 1);
+    const int next_bin = min(bin + 1, bin_range - 1);
+    const double fraction = min(max(position - bin, 0.0), 1.0);
+    ln_dos[ee] = (1 - fraction) * ln_bin_dos[bin] + fraction * ln_bin_dos[next_bin];
+    if (ln_dos[ee] > max_ln_dos) {
+      max_ln_dos = ln_dos[ee];
+      entropy_peak = ee;
+    }
+  }
+
+  // normalize the density of states to 1 at the entropy peak
+  for (int ee = 0; ee < energy_range; ee++) {
+    ln_dos[ee] -= max_ln_dos;
+  }
+}
+
+// estimate the density of states from the moments of the couplings
+// the energy E = -\sum_{i<j} J_{ij} s_i s_j of a uniformly random state is a sum of many
+//   terms with zero mean, so it is approximately normally distributed with mean zero
+//   and variance \sum_{i<j} J_{ij}^2, which means that (up to normalization)
+//   ln g(E) ~= -E^2 / (2 \sum_{i<j} J_{ij}^2)
+// this estimate is good near the entropy peak, but neglects the (pattern) states in
+//   the low energy tail of the distribution
+void network_simulation::estimate_dos_from_couplings() {
+  double variance = 0;
+  for (int ii = 0; ii < network.nodes; ii++) {
+    for (int jj = ii + 1; jj < network.nodes; jj++) {
+      variance += double(network.couplings[ii][jj]) * network.couplings[ii][jj];
+    }
+  }
+  // index of the energy E = 0, and the variance of energy indices
+  const double zero_energy = (-double(network.min_energy) / network.energy_scale
+                              - window_offset);
+  variance /= network.energy_scale * network.energy_scale;
+
+  ln_dos_estimate = vector<double>(energy_range);
+  for (int ee = 0; ee < energy_range; ee++) {
+    ln_dos_estimate[ee] = - (ee - zero_energy) * (ee - zero_energy) / (2 * variance);
+  }
+  ln_dos = ln_dos_estimate;
+  entropy_peak = min(max(int(round(zero_energy)), 0), energy_range - 1);
+}
+
+// estimate the density of states from that of another simulation, interpolating its
+//   (logarithm) linearly in the actual energy between the energies it has seen, and
+//   extending it as a constant past the lowest and highest of these energies
+void network_simulation::estimate_dos_from_simulation(const network_simulation& other) {
+  vector<int> seen_energies; // (actual) energies seen by the other simulation
+  for (int ee = 0; ee < other.energy_range; ee++) {
+    if (other.energy_histogram[ee] > 0) seen_energies.push_back(other.actual_energy(ee));
+  }
+  assert(!seen_energies.empty());
+
+  ln_dos_estimate = vector<double>(energy_range);
+  int next_seen = 0; // index of the lowest seen energy above the current energy
+  for (int ee = 0; ee < energy_range; ee++) {
+    const int energy = actual_energy(ee);
+    while (next_seen < int(seen_energies.size()) && seen_energies[next_seen] < energy) {
+      next_seen++;
+    }
+    if (next_seen == 0) {
+      ln_dos_estimate[ee] = other.ln_dos[other.energy_index(seen_energies[0])];
+    } else if (next_seen == int(seen_energies.size())) {
+      ln_dos_estimate[ee] = other.ln_dos[other.energy_index(seen_energies.back())];
+    } else {
+      const int lower_energy = seen_energies[next_seen - 1];
+      const int upper_energy = seen_energies[next_seen];
+      const double fraction = double(energy - lower_energy) / (upper_energy - lower_energy);
+      ln_dos_estimate[ee]
+        = ((1 - fraction) * other.ln_dos[other.energy_index(lower_energy)]
+           + fraction * other.ln_dos[other.energy_index(upper_energy)]);
+    }
+  }
+  ln_dos = ln_dos_estimate;
+
+  entropy_peak = 0;
+  for (int ee = 0; ee < energy_range; ee++) {
+    if (ln_dos[ee] > ln_dos[entropy_peak]) entropy_peak = ee;
+  }
+}
+
 // compute density of states from the energy histogram
 void network_simulation::compute_dos_from_energy_histogram() {
   if (fixed_temp) return;
@@ -387,7 +1054,9 @@ void network_simulation::compute_weights_from_dos(const double temp) {
   // reset the weight array
   ln_weights = vector<double>(energy_range, 0);
 
-  if (temp > 0) {
+  // if we want two-sided weights, we set the weights on both sides of the entropy peak,
+  //   using the magnitude of the simulation temperature on both sides
+  if (temp > 0 || two_sided) {
     // if we care about positive temperatures, then we are interested in low energies
     // identify the lowest energy we have seen
     int lowest_seen_energy = 0;
@@ -401,7 +1070,7 @@ void network_simulation::compute_weights_from_dos(const double temp) {
     // in the relevant range of observed energies, set weights appropriately,
     //   but never set any weight higher than we would at the simulation temperature
     double excess_weight = 0;
-    const double max_diff = energy_range / temp;
+    const double max_diff = energy_range / abs(temp);
     for (int ee = entropy_peak - 1; ee >= lowest_seen_energy; ee--) {
       ln_weights[ee] = -ln_dos[ee];
       const double diff = ln_weights[ee] - ln_weights[ee+1];
@@ -413,10 +1082,11 @@ void network_simulation::compute_weights_from_dos(const double temp) {
     // below all observed energies, use fixed temperature weights
     for (int ee = 0; ee < lowest_seen_energy; ee++) {
       ln_weights[ee] = (-ln_dos[lowest_seen_energy]
-                        + (lowest_seen_energy - ee) / temp);
+                        + (lowest_seen_energy - ee) / abs(temp));
     }
 
-  } else { // if temp < 0
+  }
+  if (temp < 0 || two_sided) {
 
     // if we care about negative temperatures, then we are interested in high energies
     // identify the highest energy we have seen
@@ -431,7 +1101,7 @@ void network_simulation::compute_weights_from_dos(const double temp) {
     // in the relevant range of observed energies, set weights appropriately
     //   but never set any weight higher than we would at the simulation temperature
     double excess_weight = 0;
-    const double max_diff = - energy_range / temp;
+    const double max_diff = energy_range / abs(temp);
     for (int ee = entropy_peak + 1; ee <= highest_seen_energy; ee++) {
       ln_weights[ee] = -ln_dos[ee];
       const double diff = ln_weights[ee] - ln_weights[ee-1];
@@ -443,7 +1113,7 @@ void network_simulation::compute_weights_from_dos(const double temp) {
     // above all observed energies, use fixed temperature weights
     for (int ee = highest_seen_energy + 1; ee < energy_range; ee++) {
       ln_weights[ee] = (-ln_dos[highest_seen_energy]
-                        + (highest_seen_energy - ee) / temp);
+                        - (highest_seen_energy - ee) / abs(temp));
     }
   }
 
@@ -452,6 +1122,20 @@ void network_simulation::compute_weights_from_dos(const double temp) {
 // expectation value of fractional sample error at the simulation temperature
 // WARNING: assumes that the density of states is up to date
 double network_simulation::fractional_sample_error(const double temp) const {
+  // with two-sided weights, we need to reach our target on both sides of the peak
+  if (two_sided) {
+    return max(one_sided_sample_error(abs(temp)), one_sided_sample_error(-abs(temp)));
+  }
+  return one_sided_sample_error(temp);
+}
+
+// expectation value of fractional sample error at a temperature on one side of the peak
+double network_simulation::one_sided_sample_error(const double temp) const {
+
+  // if we know of a lower energy than we have sampled, we are nowhere near done
+  if (temp > 0 && known_ground_energy >= 0 && sample_histogram[known_ground_energy] == 0) {
+    return 1;
+  }
 
   // determine the lowest and highest energies we care about
   int lowest_energy;
@@ -480,9 +1164,27 @@ double network_simulation::fractional_sample_error(const double temp) const {
   const int mean_energy = (highest_energy + lowest_energy) / 2;
 
   // sum up the fractional error in sample counts with appropriate boltzmann factors
+  // if we work with energy bins, we sum up the errors in the sample counts of bins
   long double error = 0;
   long double normalization = 0; // this is the partition function
-  for (int ee = lowest_energy; ee < highest_energy; ee++) {
+  if (bin_width > 1) {
+    vector<long double> bin_boltzmann_factors(bin_range, 0);
+    vector<long> bin_samples(bin_range, 0);
+    for (int ee = lowest_energy; ee < highest_energy; ee++) {
+      if (sample_histogram[ee] == 0) continue;
+      const long double ln_dos_ee = ln_dos[ee] - ln_dos[mean_energy];
+      const long double energy = ee - mean_energy;
+      const long double boltzmann_factor = expl(ln_dos_ee - energy / temp);
+      bin_boltzmann_factors[ee / bin_width] += boltzmann_factor;
+      bin_samples[ee / bin_width] += sample_histogram[ee];
+      normalization += boltzmann_factor;
+    }
+    for (int bb = 0; bb < bin_range; bb++) {
+      if (bin_samples[bb] == 0) continue;
+      error += bin_boltzmann_factors[bb]/sqrt(bin_samples[bb]);
+    }
+  }
+  for (int ee = lowest_energy; ee < highest_energy && bin_width == 1; ee++) {
     if (sample_histogram[ee] != 0) {
       // offset ln_dos[ee] and the energy ee by their values at the mean energy
       //   we care about in order to avoid numerical overflows
@@ -510,10 +1212,10 @@ void network_simulation::write_transitions_file(const string transitions_file,
                     << "# (row)x(column) = (energy)x(de)" << endl;
   for (int ee = 0; ee < energy_range; ee++) {
     if (energy_histogram[ee] == 0) continue;
-    transition_stream << network.actual_energy(ee)
-                      << " " << transitions(ee, -max_de);
-    for (int de = -max_de + 1; de <= max_de; de++) {
-      transition_stream << " " << transitions(ee, de);
+    transition_stream << actual_energy(ee)
+                      << " " << transition_histogram[ee][0];
+    for (int dd = 1; dd < 2*max_de + 1; dd++) {
+      transition_stream << " " << transition_histogram[ee][dd];
     }
     transition_stream << endl;
   }
@@ -529,7 +1231,7 @@ void network_simulation::write_weights_file(const string weights_file,
   for (int ee = 0; ee < energy_range; ee++) {
     if (energy_histogram[ee] == 0) continue;
     weight_stream << setprecision(numeric_limits<double>::max_digits10)
-                  << network.actual_energy(ee) << " "
+                  << actual_energy(ee) << " "
                   << ln_weights[ee] << endl;
   }
   weight_stream.close();
@@ -544,7 +1246,7 @@ void network_simulation::write_energy_file(const string energy_file,
   energy_stream << endl;
   for (int ee = 0; ee < energy_range; ee++) {
     if (energy_histogram[ee] == 0)  continue;
-    energy_stream << network.actual_energy(ee) << " " << energy_histogram[ee];
+    energy_stream << actual_energy(ee) << " " << energy_histogram[ee];
     if (!fixed_temp) energy_stream << " " << sample_histogram[ee];
     energy_stream << endl;
   }
@@ -559,7 +1261,7 @@ void network_simulation::write_distance_file(const string distance_file,
     distance_stream << "# energy, records, distance log" << endl;
     for (int ee = 0; ee < energy_range; ee++) {
       if (all_temp_distance_records[ee] == 0)  continue;
-      distance_stream << network.actual_energy(ee) << " "
+      distance_stream << actual_energy(ee) << " "
                       << all_temp_distance_records[ee] << " "
                       << all_temp_distance_logs[ee] << endl;
     }
@@ -593,7 +1295,7 @@ void network_simulation::read_transitions_file(const string transitions_file) {
     if (line[0] == '#' || line.empty()) continue;
     stringstream line_stream(line);
     line_stream >> word;
-    const int ee = (stoi(word) + network.max_energy) / network.energy_scale;
+    const int ee = energy_index(stoi(word));
     energy_histogram[ee]++; // mark this energy as seen
     for (int dd = 0; dd < 2*max_de + 1 ; dd++) {
       line_stream >> word;
@@ -612,8 +1314,10 @@ void network_simulation::read_weights_file(const string weights_file) {
   bool lowest_seen_energy_set = false;
   int lowest_seen_energy, highest_seen_energy;
 
-  // maximum temperature of interest specified in weights file
+  // maximum temperature of interest specified in weights file,
+  //   and whether the file contains weights on both sides of the entropy peak
   double temp;
+  bool two_sided_file = false;
 
   cout << "reading in weight array" << endl;
   ifstream input(weights_file.c_str());
@@ -625,14 +1329,19 @@ void network_simulation::read_weights_file(const string weights_file) {
     line_stream >> word;
 
     if (word == "#") {
-      if (word.find("input_temp") != string::npos) {
+      line_stream >> word;
+      if (word == "input_temp:") {
         line_stream >> word;
         temp = stod(word) * network.nodes / network.energy_scale;
       }
+      if (word == "two_sided:") {
+        line_stream >> word;
+        two_sided_file = (stoi(word) != 0);
+      }
       continue;
     }
 
-    const int ee = (stoi(word) + network.max_energy) / network.energy_scale;
+    const int ee = energy_index(stoi(word));
     energy_histogram[ee]++; // mark this energy as seen
 
     if (!lowest_seen_energy_set) {
@@ -654,24 +1363,25 @@ void network_simulation::read_weights_file(const string weights_file) {
     }
   }
 
-  // fill in the weight array within the range of seen energies
+  // fill in the weight array at energies missing from the file
+  //   within the range of seen energies
   for (int ee = lowest_seen_energy + 1; ee < highest_seen_energy; ee++) {
-    if (ln_weights[ee] == 0) ln_weights[ee] = ln_weights[ee-1];
+    if (energy_histogram[ee] == 0) ln_weights[ee] = ln_weights[ee-1];
   }
 
   // set entropy peak and fill in the rest of the weight array
-  if (temp > 0) {
-    entropy_peak = first_zero;
+  // note: in a two-sided weights file, the entropy peak is the only zero weight
+  entropy_peak = (temp > 0 || two_sided_file) ? first_zero : last_zero;
+  if (temp > 0 || two_sided_file) {
     for (int ee = 0; ee < lowest_seen_energy; ee++) {
       ln_weights[ee] = (ln_weights[lowest_seen_energy]
-                        + (lowest_seen_energy - ee) / temp);
+                        + (lowest_seen_energy - ee) / abs(temp));
     }
-
-  } else { // if temp < 0
-    entropy_peak = last_zero;
+  }
+  if (temp < 0 || two_sided_file) {
     for (int ee = highest_seen_energy + 1; ee < energy_range; ee++) {
       ln_weights[ee] = (ln_weights[highest_seen_energy]
-                        + (highest_seen_energy - ee) / temp);
+                        - (highest_seen_energy - ee) / abs(temp));
     }
   }
 
@@ -683,7 +1393,7 @@ void network_simulation::read_weights_file(const string weights_file) {
 
 // print patterns defining the simulated network
 void network_simulation::print_patterns() const {
-  const int energy_width = log10(network.max_energy) + 2;
+  const int energy_width = log10(max(-network.min_energy, network.max_energy)) + 2;
   const int index_width = log10(pattern_number) + 1;
 
   // make list of the pattern energies
@@ -703,7 +1413,7 @@ void network_simulation::print_patterns() const {
   cout << "(energy, index) pattern" << endl;
   for (int ss = pattern_number - 1; ss >= 0; ss--) {
     cout << "(" << setw(energy_width)
-         << network.actual_energy(sorted_energies[ss]) << ", ";
+         << actual_energy(sorted_energies[ss]) << ", ";
     for (int pp = 0; pp < pattern_number; pp++) {
       if (energies[pp] == sorted_energies[ss] && !printed[pp]) {
         cout << setw(index_width) << pp << ")";
@@ -727,7 +1437,7 @@ void network_simulation::print_energy_data() const {
     most_observations = max(energy_histogram[ee], most_observations);
   }
   cout << "energy observations samples log10_dos ln10_weights" << endl;
-  const int energy_width = log10(network.max_energy) + 2;
+  const int energy_width = log10(max(-network.min_energy, network.max_energy)) + 2;
   const int energy_hist_width = log10(most_observations) + 1;
   const int sample_width = log10(sample_histogram[entropy_peak]) + 1;
   const int double_dec = 6; // decimal precision with which to print doubles
@@ -736,7 +1446,7 @@ void network_simulation::print_energy_data() const {
     if (observations == 0) continue;
     cout << fixed
          << setw(energy_width)
-         << network.actual_energy(ee) << " "
+         << actual_energy(ee) << " "
          << setw(energy_hist_width) << observations << " "
          << setw(sample_width) << sample_histogram[ee] << " "
          << setw(double_dec + 3) << setprecision(double_dec)
@@ -750,7 +1460,7 @@ void network_simulation::print_energy_data() const {
 void network_simulation::print_distances() const {
   if (!fixed_temp) {
     cout << "energy distance" << endl;
-    const int energy_width = log10(network.max_energy) + 2;
+    const int energy_width = log10(max(-network.min_energy, network.max_energy)) + 2;
     for (int ee = energy_range - 1; ee >= 0; ee--) {
       // check that we have sampled distance this energy
       const long observations = all_temp_distance_records[ee];
@@ -758,7 +1468,7 @@ void network_simulation::print_distances() const {
 
       const double val = double(all_temp_distance_logs[ee]) / observations;
       cout << setw(energy_width)
-           << network.actual_energy(ee) << " "
+           << actual_energy(ee) << " "
            << val * 2 / network.nodes << endl;
     }
   } else {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <random> // for randomness
+#include <limits> // for numeric limits
 
 using namespace std;
 
@@ -13,9 +14,15 @@ int gcd(const int a, const int b);
 vector<bool> random_state(const int nodes, uniform_real_distribution<double>& rnd,
                           mt19937_64& generator);
 
+// integrated autocorrelation time of a series of measurements (in units of the spacing
+//   between measurements), estimated from the variance of block means; if the series is
+//   too short to contain many blocks much longer than this time, we underestimate it
+double autocorrelation_time(const vector<double>& series);
+
 struct hopfield_network {
 
-  // number of nodes in network
+  // patterns used to construct the network, and the number of nodes in the network
+  vector<vector<bool>> patterns;
   int nodes;
 
   // coupling constants between nodes
@@ -24,19 +31,43 @@ struct hopfield_network {
   // energy resolution necessary to keep track of all distinct energies
   int energy_scale;
 
-  // maximum energy of the network, and maximum by which
-  //   this energy can change by flipping one spin
-  // in units of energy_scale
+  // (bounds on the) minimum and maximum energies of the network,
+  //   and the maximum amount by which the energy can change by flipping one spin
+  // note: energy indices are (actual energy - min_energy) / energy_scale
+  int min_energy;
   int max_energy;
   int max_energy_change;
 
+  // number of nodes in each block of a coupling row, and bounds on the sum of
+  //   absolute couplings in each row past the start of every block
+  // coupling_tail_bounds[ii][bb] = \sum_{jj >= bb * coupling_block_size} |J_{ii,jj}|,
+  //   with a trailing zero past the last block
+  static const int coupling_block_size = 32;
+  vector<vector<int>> coupling_tail_bounds;
+
   // hopfield network constructor
   hopfield_network(const vector<vector<bool>>& patterns);
 
+  // add a pattern to the network, or remove the pattern with a given index from it,
+  //   updating the couplings by the (rank-1) contribution of this pattern and
+  //   recomputing the energy scale, bounds, and maximum energy change
+  // the couplings take O(nodes^2) time to update, and the energy bounds
+  //   O(patterns^2 nodes + patterns^3) time to recompute
+  void add_pattern(const vector<bool>& pattern);
+  void remove_pattern(const int pattern);
+
+  // add (sign = 1) or subtract (sign = -1) the couplings x_i x_j of a pattern x
+  void update_couplings(const vector<bool>& pattern, const int sign);
+
+  // compute the energy scale, bounds, and maximum energy change of the network,
+  //   as well as the bounds on its coupling rows used for early rejection of node flips
+  void compute_energy_data();
+
   // (index of) energy of the network in a given state
   int energy(const vector<bool>& state) const;
 
-  // convert energy index to an "actual" energy
+  // convert between energy indices and "actual" energies
+  int energy_index(const int actual_energy) const;
   int actual_energy(const int energy_index) const;
 
   // print coupling matrix
@@ -57,6 +88,12 @@ struct network_simulation {
   // the network itself
   const hopfield_network network;
 
+  // (index of) the lowest energy in the window of energies we simulate;
+  //   all energy indices in this simulation are taken relative to this energy
+  // note: unless we restrict the simulation to a window, this is the lowest energy of
+  //   the network, and window_offset is zero
+  const int window_offset;
+
   // the energy range, and the max amount by which the energy can change in one move
   const int energy_range;
   const int max_de;
@@ -80,12 +117,40 @@ struct network_simulation {
   // note: only used in all temperature simulations
   vector<double> ln_dos;
 
+  // do we want weights which cover both positive and negative temperatures,
+  //   i.e. flatten the density of states on both sides of the entropy peak?
+  // note: only used in all temperature simulations
+  bool two_sided = false;
+
+  // an a priori estimate of ln_dos, which (if we have one) the initialization routine
+  //   falls back on when it has no data on a transition
+  // note: only used in all temperature simulations
+  vector<double> ln_dos_estimate;
+
+  // (index of) the lowest energy of any state we know of (e.g. from a ground state
+  //   search), or -1 if we know of no such state; until we have sampled this energy,
+  //   we consider the sample error at positive temperatures to be 1
+  // note: only used in all temperature simulations
+  int known_ground_energy = -1;
+
   // stores the number times we have proposed a move
   //   from a given energy with a specified energy difference
   // indexed by (energy, change in energy)
   // note: only used in all temperature simulations
   vector<vector<long>> transition_histogram;
 
+  // width of the energy bins which the initialization routine works with
+  // if bin_width > 1, the init acceptance rule, the density of states, and the sample
+  //   error are all computed from the statistics of bins of bin_width adjacent energies,
+  //   which we keep in a transition histogram between bins, indexed by
+  //   (bin, change in bin), with bin = energy / bin_width
+  // the density of states at every energy is then interpolated from that of the bins
+  // note: only used in all temperature simulations
+  int bin_width = 1;
+  int bin_range;
+  int max_bin_de;
+  vector<vector<long>> bin_transition_histogram;
+
   // visit_log[ee] answers the question: have we visited the energy ee
   // at least once since the last observation of a maximual entropy state?
   // note: only used in all temperature simulations
@@ -120,9 +185,19 @@ struct network_simulation {
   long fixed_temp_distance_log = 0;
 
   // constructor for the network simulation object
+  // if given, we only simulate the (actual) energies in [lowest_energy, highest_energy]
   network_simulation(const vector<vector<bool>>& patterns,
                      const vector<bool>& initial_state,
-                     const bool fixed_temp);
+                     const bool fixed_temp,
+                     const int lowest_energy = numeric_limits<int>::min(),
+                     const int highest_energy = numeric_limits<int>::max());
+
+  // constructor for a network simulation of an existing network
+  network_simulation(const hopfield_network& network,
+                     const vector<bool>& initial_state,
+                     const bool fixed_temp,
+                     const int lowest_energy = numeric_limits<int>::min(),
+                     const int highest_energy = numeric_limits<int>::max());
 
   // -------------------------------------------------------------------------------------
   // Access methods for histograms and matrices
@@ -134,6 +209,11 @@ struct network_simulation {
   // number of attempted transitions from a given energy into any other energy
   long transitions_from(const int energy) const;
 
+  // number of attempted transitions from a given energy bin with a specified change
+  //   in bin, and from a given energy bin into any other bin
+  long bin_transitions(const int bin, const int bin_change) const;
+  long bin_transitions_from(const int bin) const;
+
   // elements of the actual normalized transition matrix:
   //   the probability of proposing a move from a given initial energy
   //   into a specific final energy
@@ -144,12 +224,58 @@ struct network_simulation {
   // -------------------------------------------------------------------------------------
 
   // compute energy change due to flipping a node from its current state
-  int node_flip_energy_change(const int node) const;
+  int node_flip_energy_change(const vector<bool>& state, const int node) const;
+  int node_flip_energy_change(const int node) const {
+    return node_flip_energy_change(state, node);
+  };
+
+  // compute energy change due to flipping a node in a fixed temperature simulation,
+  //   giving up early (and returning false) if we can prove that the move would fail
+  //   a metropolis test against the (already drawn) random number acceptance_draw
+  bool node_flip_energy_change(const vector<bool>& state, const int node,
+                               const double temp, const double acceptance_draw,
+                               int& energy_change) const;
+  bool node_flip_energy_change(const int node, const double temp,
+                               const double acceptance_draw, int& energy_change) const {
+    return node_flip_energy_change(state, node, temp, acceptance_draw, energy_change);
+  };
+
+  // propose a pattern-directed move from a given state: pick a target (one of the
+  //   patterns or their inverses) at random, and flip a random subset of k of the d nodes
+  //   on which the state disagrees with the target, with k uniform in [1, d]
+  // returns false if the state already matches the target; otherwise sets the nodes to
+  //   flip, the energy change of the move, and the logarithm of the ratio between the
+  //   probabilities of proposing the reverse move and this one, by which we must
+  //   multiply the acceptance probability in order to satisfy detailed balance
+  bool propose_pattern_move(const vector<bool>& state,
+                            uniform_real_distribution<double>& rnd, mt19937_64& generator,
+                            vector<int>& flips, int& energy_change,
+                            double& ln_proposal_ratio) const;
 
   // the energy of a given state
-  int energy(const vector<bool>& state) const { return network.energy(state); };
+  int energy(const vector<bool>& state) const {
+    return network.energy(state) - window_offset;
+  };
   int energy() const { return energy(state); };
 
+  // convert between energies and "actual" energies
+  int energy_index(const int actual_energy) const {
+    return network.energy_index(actual_energy) - window_offset;
+  };
+  int actual_energy(const int energy) const {
+    return network.actual_energy(energy + window_offset);
+  };
+
+  // is a given energy within the window of energies we simulate?
+  bool in_window(const int energy) const { return energy >= 0 && energy < energy_range; };
+
+  // walk from the current state into the window of energies we simulate, accepting
+  //   moves which bring us farther from the window with a boltzmann probability at
+  //   temperature temp; returns false if we fail to enter the window in a given number
+  //   of moves
+  bool enter_window(const long max_moves, const double temp,
+                    uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
   // probability to accept a move
   double move_probability(const int current_energy, const int energy_change,
                           const double temp);
@@ -157,15 +283,49 @@ struct network_simulation {
   // initialize all tables and histograms
   void initialize_histograms();
 
+  // set the width of the energy bins used by the initialization routine,
+  //   and collect the transitions between bins from the transition histogram
+  void set_bin_width(const int width);
+
   // update histograms with an observation
   void update_distance_logs(const int energy);
   void update_state_histograms();
   void update_sample_histogram(const int new_energy, const int old_energy);
   void update_transition_histogram(const int energy, const int energy_change);
 
+  // probability to accept a move during the all-temperature initialization routine
+  double init_move_probability(const int current_energy, const int energy_change,
+                               const double temp) const;
+
+  // run one cycle of the all-temperature initialization routine from the current state,
+  //   recording proposed moves in the transition histogram,
+  //   and visited energies in the energy and sample histograms
+  void init_cycle(const long moves, const double temp,
+                  uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // merge the histograms recorded by copies of this simulation (i.e. shards), all of
+  //   which started the last initialization cycle with the same histograms as this one,
+  //   and bring all shards up to date with the merged histograms
+  // note: the entropy peak of the shards is not updated here, as it is only known once we
+  //   compute the density of states from the merged histograms
+  void merge_init_shards(vector<network_simulation>& shards);
+
   // compute density of states from the transition matrix
   void compute_dos_from_transitions();
 
+  // compute density of states from the transition matrix between energy bins
+  void compute_dos_from_bin_transitions();
+
+  // estimate the density of states from the moments of the couplings, and use this
+  //   estimate as our initial density of states and a priori estimate
+  void estimate_dos_from_couplings();
+
+  // estimate the density of states from that of another simulation (e.g. of a network
+  //   with one pattern fewer), and use this estimate as our initial density of states
+  //   and a priori estimate
+  // WARNING: assumes that the density of states of the other simulation is up to date
+  void estimate_dos_from_simulation(const network_simulation& other);
+
   // compute density of states from the energy histogram
   void compute_dos_from_energy_histogram();
 
@@ -174,8 +334,10 @@ struct network_simulation {
   void compute_weights_from_dos(const double temp);
 
   // expectation value of fractional sample error at the simulation temperature
+  //   (with two-sided weights: the larger error at +/- the simulation temperature)
   // WARNING: assumes that the density of states is up to date
   double fractional_sample_error(const double temp) const;
+  double one_sided_sample_error(const double temp) const;
 
   // -------------------------------------------------------------------------------------
   // Writing/reading data files
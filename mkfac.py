@@ -47,6 +47,7 @@ lib_flags["boost"] = ["-lboost_system"]
 lib_flags["boost/filesystem"] = ["-lboost_filesystem"]
 lib_flags["boost/program_options"] = ["-lboost_program_options"]
 lib_flags["gsl"] = ["-lgsl"]
+lib_flags["<thread>"] = ["-pthread"]
 
 fac_text = ""
 global_libraries = []
@@ -0,0 +1,294 @@
+#include <iostream> // for standard output
+#include <random> // for randomness
+#include <cstdint> // for fixed-width integer types
+#include <cassert> // for assertions
+#include <algorithm> // for min and max
+
+#include "methods.h"
+#include "multispin.h"
+
+using namespace std;
+
+// multi-spin coded simulation constructor
+multispin_simulation::multispin_simulation(const network_simulation& ns,
+                                           const int replicas,
+                                           uniform_real_distribution<double>& rnd,
+                                           mt19937_64& generator) :
+  ns(ns),
+  replicas(replicas)
+{
+  assert(replicas > 0 && replicas <= max_replicas);
+  const int nodes = ns.network.nodes;
+
+  // initialize replica states and energies
+  states = vector<uint64_t>(nodes, 0);
+  energies = vector<int>(replicas);
+  for (int rr = 0; rr < replicas; rr++) {
+    const vector<bool> state = (rr == 0) ? ns.state : random_state(nodes, rnd, generator);
+    for (int ii = 0; ii < nodes; ii++) {
+      states[ii] |= uint64_t(state[ii]) << rr;
+    }
+    energies[rr] = ns.energy(state);
+  }
+
+  // decompose the couplings into their nonzero bit planes
+  coupling_planes = vector<vector<coupling_plane>>(nodes);
+  row_sums = vector<int>(nodes, 0);
+  for (int ii = 0; ii < nodes; ii++) {
+    // make sure that the counters we use for bit-sliced arithmetic cannot overflow
+    assert(ns.network.coupling_tail_bounds[ii][0] < (long(1) << (max_planes - 1)));
+    for (const bool negative : { false, true }) {
+      for (int bb = 0; bb < max_planes; bb++) {
+        coupling_plane plane = { bb, negative, {} };
+        for (int jj = 0; jj < nodes; jj++) {
+          const int coupling = ns.network.couplings[ii][jj];
+          if ((coupling < 0) == negative && ((abs(coupling) >> bb) & 1)) {
+            plane.nodes.push_back(jj);
+          }
+        }
+        if (!plane.nodes.empty()) coupling_planes[ii].push_back(plane);
+      }
+    }
+    for (int jj = 0; jj < nodes; jj++) {
+      row_sums[ii] += ns.network.couplings[ii][jj];
+    }
+  }
+
+  // initialize histograms
+  energy_histograms = vector<vector<long>>(replicas, vector<long>(ns.energy_range, 0));
+  distance_logs = vector<long>(replicas, 0);
+  state_histograms = vector<vector<long>>(replicas, vector<long>(nodes, 0));
+  energy_since = vector<long>(replicas, 0);
+  ones_since = vector<vector<long>>(replicas, vector<long>(nodes, 0));
+}
+
+// state of a single replica
+vector<bool> multispin_simulation::replica_state(const int replica) const {
+  vector<bool> state(ns.network.nodes);
+  for (int ii = 0; ii < ns.network.nodes; ii++) {
+    state[ii] = (states[ii] >> replica) & 1;
+  }
+  return state;
+}
+
+// compute the energy changes due to flipping a node in every replica
+// the energy change in replica rr is
+//   2/energy_scale * \sum_jj J_{node,jj} s_node s_jj
+//   = 2/energy_scale * (2 * \sum_jj J_{node,jj} a_jj - \sum_jj J_{node,jj}),
+//   where a_jj = 1 if s_node = s_jj in replica rr, and 0 otherwise
+// we compute the sum of couplings J_{node,jj} over aligned nodes jj in every replica
+//   at once, by adding the bits of |J_{node,jj}| into bit-sliced counters
+//   (one for positive and one for negative couplings) in which bit rr of plane bb
+//   is bit bb of the count for replica rr
+// within each bit plane of the couplings, we first sum up masks of aligned nodes
+//   with a tree of carry-save adders, so that we only need to propagate carries
+//   through the counters once for every eight nodes
+void multispin_simulation::node_flip_energy_changes(const int node,
+                                                    int energy_changes[]) const {
+  uint64_t positive_counter[max_planes + 3] = {};
+  uint64_t negative_counter[max_planes + 3] = {};
+
+  const uint64_t node_states = states[node];
+  for (const coupling_plane& plane : coupling_planes[node]) {
+    uint64_t* counter = plane.negative ? negative_counter : positive_counter;
+    const int bb = plane.plane;
+    const int* nodes = plane.nodes.data();
+    const int size = plane.nodes.size();
+
+    // masks of the replicas in which a node is aligned with the flipped node
+    auto aligned = [&](const int index) -> uint64_t {
+      return ~(node_states ^ states[nodes[index]]);
+    };
+
+    // running sums with weights 1, 2, and 4
+    uint64_t ones = 0, twos = 0, fours = 0;
+    uint64_t twos_a, twos_b, fours_a, fours_b, eights;
+    int index = 0;
+    for (; index + 8 <= size; index += 8) {
+      carry_save_add(twos_a, ones, ones, aligned(index), aligned(index + 1));
+      carry_save_add(twos_b, ones, ones, aligned(index + 2), aligned(index + 3));
+      carry_save_add(fours_a, twos, twos, twos_a, twos_b);
+      carry_save_add(twos_a, ones, ones, aligned(index + 4), aligned(index + 5));
+      carry_save_add(twos_b, ones, ones, aligned(index + 6), aligned(index + 7));
+      carry_save_add(fours_b, twos, twos, twos_a, twos_b);
+      carry_save_add(eights, fours, fours, fours_a, fours_b);
+      bit_sliced_add(counter, eights, bb + 3);
+    }
+    for (; index < size; index++) {
+      bit_sliced_add(counter, aligned(index), bb);
+    }
+    bit_sliced_add(counter, ones, bb);
+    bit_sliced_add(counter, twos, bb + 1);
+    bit_sliced_add(counter, fours, bb + 2);
+  }
+
+  // number of counter planes in use
+  int planes = max_planes + 3;
+  while (planes > 0 && positive_counter[planes-1] == 0
+         && negative_counter[planes-1] == 0) {
+    planes--;
+  }
+
+  // subtract the negative counter from the positive one in all replicas at once,
+  //   which leaves a (two's complement) difference and a sign (i.e. final borrow) bit
+  uint64_t difference[max_planes];
+  uint64_t borrow = 0;
+  for (int bb = 0; bb < planes; bb++) {
+    const uint64_t positive = positive_counter[bb];
+    const uint64_t negative = negative_counter[bb];
+    difference[bb] = positive ^ negative ^ borrow;
+    borrow = (~positive & (negative | borrow)) | (negative & borrow);
+  }
+
+  // extract the difference in each replica from the bit planes
+  for (int rr = 0; rr < replicas; rr++) {
+    int aligned_sum = - (int((borrow >> rr) & 1) << planes);
+    for (int bb = 0; bb < planes; bb++) {
+      aligned_sum += int((difference[bb] >> rr) & 1) << bb;
+    }
+    energy_changes[rr] = 2 * (2 * aligned_sum - row_sums[node]) / ns.network.energy_scale;
+  }
+}
+
+// record the distance of every replica from the nearest pattern
+void multispin_simulation::update_distance_logs() {
+  const int nodes = ns.network.nodes;
+  vector<int> min_distances(replicas, nodes);
+  for (int pp = 0; pp < ns.pattern_number; pp++) {
+    // count the overlap between every replica and pattern pp in a bit-sliced counter
+    uint64_t counter[max_planes] = {};
+    for (int ii = 0; ii < nodes; ii++) {
+      bit_sliced_add(counter, ns.patterns[pp][ii] ? states[ii] : ~states[ii], 0);
+    }
+    for (int rr = 0; rr < replicas; rr++) {
+      int overlap = 0;
+      for (int bb = 0; (nodes >> bb) != 0; bb++) {
+        overlap += int((counter[bb] >> rr) & 1) << bb;
+      }
+      min_distances[rr] = min({min_distances[rr], overlap, nodes - overlap});
+    }
+  }
+  for (int rr = 0; rr < replicas; rr++) {
+    distance_logs[rr] += min_distances[rr];
+  }
+  distance_records++;
+}
+
+// run for a given number of moves at a fixed temperature,
+//   recording data from every move if record is true
+void multispin_simulation::run(const long moves, const double temp, const bool record,
+                               uniform_real_distribution<double>& rnd,
+                               mt19937_64& generator) {
+  const int nodes = ns.network.nodes;
+  const int max_de = ns.max_de;
+
+  // acceptance probabilities for all possible energy changes
+  vector<double> move_probabilities(2*max_de + 1);
+  for (int de = -max_de; de <= max_de; de++) {
+    move_probabilities[de + max_de] = exp(-de/temp);
+  }
+
+  // start keeping track of how long replicas have been at their current energies,
+  //   and how long nodes have been in the state 1
+  if (record) {
+    for (int rr = 0; rr < replicas; rr++) {
+      energy_since[rr] = records;
+      for (int ii = 0; ii < nodes; ii++) {
+        ones_since[rr][ii] = records;
+      }
+    }
+  }
+
+  int energy_changes[max_replicas];
+  for (long mm = 0; mm < moves; mm++) {
+
+    // pick a random node to possibly flip in every replica,
+    //   and compute the change in energy from flipping it
+    const int node = floor(rnd(generator) * nodes);
+    node_flip_energy_changes(node, energy_changes);
+
+    // decide whether to accept the move in each replica; we only need to draw
+    //   random numbers for moves which are not accepted with certainty
+    uint64_t accepted = 0;
+    for (int rr = 0; rr < replicas; rr++) {
+      const int de = energy_changes[rr];
+      if ((temp > 0 && de <= 0) || (temp < 0 && de >= 0) ||
+          rnd(generator) < move_probabilities[de + max_de]) {
+        accepted |= uint64_t(1) << rr;
+      }
+    }
+
+    // flip the node in the replicas which accepted the move, and if we are recording
+    //   data, update the energy and state histograms of these replicas
+    for (uint64_t flips = accepted; flips; flips &= flips - 1) {
+      const int rr = __builtin_ctzll(flips);
+      if (record) {
+        energy_histograms[rr][energies[rr]] += records - energy_since[rr];
+        energy_since[rr] = records;
+        if ((states[node] >> rr) & 1) {
+          state_histograms[rr][node] += records - ones_since[rr][node];
+        } else {
+          ones_since[rr][node] = records;
+        }
+      }
+      energies[rr] += energy_changes[rr];
+      assert(energies[rr] >= 0 && energies[rr] < ns.energy_range);
+    }
+    states[node] ^= accepted;
+
+    if (!record) continue;
+
+    // the distance log takes O(pattern_number) time to update,
+    //   so only upate it every [pattern_number] moves
+    if (records % ns.pattern_number == 0) {
+      update_distance_logs();
+    }
+
+    records++;
+  }
+
+  // make sure that we have kept track of energies correctly
+  for (int rr = 0; rr < replicas; rr++) {
+    assert(energies[rr] == ns.energy(replica_state(rr)));
+  }
+
+  // bring energy and state histograms up to date
+  if (record) {
+    for (int rr = 0; rr < replicas; rr++) {
+      energy_histograms[rr][energies[rr]] += records - energy_since[rr];
+      for (int ii = 0; ii < nodes; ii++) {
+        if ((states[ii] >> rr) & 1) {
+          state_histograms[rr][ii] += records - ones_since[rr][ii];
+        }
+      }
+    }
+  }
+}
+
+// copy the data recorded by one replica into a simulation object
+void multispin_simulation::export_replica(const int replica,
+                                          network_simulation& target) const {
+  target.energy_histogram = energy_histograms[replica];
+  target.fixed_temp_distance_records = distance_records;
+  target.fixed_temp_distance_log = distance_logs[replica];
+  target.state_records = records;
+  target.state_histograms = state_histograms[replica];
+}
+
+// merge the data recorded by all replicas into a simulation object
+void multispin_simulation::export_replicas(network_simulation& target) const {
+  target.energy_histogram = vector<long>(ns.energy_range, 0);
+  target.state_histograms = vector<long>(ns.network.nodes, 0);
+  target.fixed_temp_distance_log = 0;
+  for (int rr = 0; rr < replicas; rr++) {
+    for (int ee = 0; ee < ns.energy_range; ee++) {
+      target.energy_histogram[ee] += energy_histograms[rr][ee];
+    }
+    for (int ii = 0; ii < ns.network.nodes; ii++) {
+      target.state_histograms[ii] += state_histograms[rr][ii];
+    }
+    target.fixed_temp_distance_log += distance_logs[rr];
+  }
+  target.fixed_temp_distance_records = distance_records * replicas;
+  target.state_records = records * replicas;
+}
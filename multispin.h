@@ -0,0 +1,114 @@
+#pragma once
+
+#include <random> // for randomness
+#include <cstdint> // for fixed-width integer types
+
+#include "methods.h"
+
+using namespace std;
+
+// one bit plane of the couplings J_{ii,jj} in a row ii of the coupling matrix,
+//   as used in bit-sliced arithmetic: the nodes jj for which
+//   bit (plane) of |J_{ii,jj}| is set, and J_{ii,jj} has a given sign
+struct coupling_plane {
+  int plane;
+  bool negative;
+  vector<int> nodes;
+};
+
+// add a mask (i.e. 1 in every bit lane set in the mask) to a bit-sliced counter,
+//   starting at a given bit plane and propagating carries up through the planes
+inline void bit_sliced_add(uint64_t counter[], uint64_t mask, int plane) {
+  while (mask) {
+    const uint64_t carry = counter[plane] & mask;
+    counter[plane] ^= mask;
+    mask = carry;
+    plane++;
+  }
+}
+
+// carry-save adder: add three masks bitwise, storing the sum bits in low
+//   and the carry bits in high
+inline void carry_save_add(uint64_t& high, uint64_t& low,
+                           const uint64_t a, const uint64_t b, const uint64_t c) {
+  const uint64_t u = a ^ b;
+  high = (a & b) | (u & c);
+  low = u ^ c;
+}
+
+// multi-spin coded fixed-temperature simulation of up to 64 replicas of one network
+// the state of node ii in replica rr is stored in bit rr of the word states[ii],
+//   which lets us compute the energy change from flipping a node in every replica
+//   at once using bit-sliced arithmetic on the couplings
+// all replicas attempt to flip the same (randomly chosen) node on every move,
+//   but each replica accepts or rejects its move independently
+struct multispin_simulation {
+
+  static const int max_replicas = 64;
+
+  // maximum number of bit planes in the counters used for bit-sliced arithmetic
+  static const int max_planes = 32;
+
+  // single-replica simulation which provides the network, patterns, and energy range,
+  //   and into which we export replica data for writing data files
+  const network_simulation& ns;
+
+  // number of replicas
+  const int replicas;
+
+  // bit-sliced network states, and the energy of each replica
+  vector<uint64_t> states;
+  vector<int> energies;
+
+  // coupling_planes[ii] contains all nonzero bit planes of the couplings J_{ii,jj}
+  // row_sums[ii] is the sum of all couplings J_{ii,jj}
+  vector<vector<coupling_plane>> coupling_planes;
+  vector<int> row_sums;
+
+  // number of moves for which we have recorded data
+  long records = 0;
+
+  // histograms of the energies seen by each replica, indexed by (replica, energy)
+  // these histograms are updated lazily: replica rr has been at its current energy
+  //   since the record with index energy_since[rr]
+  vector<vector<long>> energy_histograms;
+  vector<long> energy_since;
+
+  // number of times we have recorded distances from patterns,
+  //   and the sum of all recorded distances for each replica
+  long distance_records = 0;
+  vector<long> distance_logs;
+
+  // number of times each replica has seen each node in the state 1,
+  //   indexed by (replica, node)
+  // these histograms are updated lazily: if node ii of replica rr is in the state 1,
+  //   it has been in that state since the record with index ones_since[rr][ii]
+  vector<vector<long>> state_histograms;
+  vector<vector<long>> ones_since;
+
+  // constructor: the state of replica 0 is taken from the simulation ns,
+  //   and all other replicas start in random states
+  multispin_simulation(const network_simulation& ns, const int replicas,
+                       uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // state of a single replica
+  vector<bool> replica_state(const int replica) const;
+
+  // compute the energy changes due to flipping a node in every replica
+  void node_flip_energy_changes(const int node, int energy_changes[]) const;
+
+  // record the distance of every replica from the nearest pattern
+  void update_distance_logs();
+
+  // run for a given number of moves at a fixed temperature,
+  //   recording data from every move if record is true
+  void run(const long moves, const double temp, const bool record,
+           uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // copy the data recorded by one replica into a simulation object
+  void export_replica(const int replica, network_simulation& target) const;
+
+  // merge the data recorded by all replicas into a simulation object
+  void export_replicas(network_simulation& target) const;
+
+};
@@ -0,0 +1,167 @@
+#include <iostream> // for standard output
+#include <random> // for randomness
+#include <cassert> // for assertions
+#include <algorithm> // for nth_element, min, and max
+#include <thread> // for multithreading
+#include <functional> // for cref and ref
+#include <map> // for map
+
+#include "methods.h"
+#include "nested_sampling.h"
+
+using namespace std;
+
+// constructor: live states start in random states
+nested_sampling::nested_sampling(const network_simulation& ns, const int live_points,
+                                 const long walk_moves, const int threads,
+                                 const long seed) :
+  ns(ns),
+  walk_moves(walk_moves)
+{
+  assert(live_points > threads && walk_moves > 0 && threads > 0);
+  for (int tt = 0; tt < threads; tt++) {
+    seed_seq thread_seed = { seed, long(tt) };
+    generators.push_back(mt19937_64(thread_seed));
+  }
+  uniform_real_distribution<double> rnd;
+  for (int kk = 0; kk < live_points; kk++) {
+    live_states.push_back(random_state(ns.network.nodes, rnd, generators[kk % threads]));
+    live_energies.push_back(ns.energy(live_states[kk]));
+  }
+  ln_removed_volume = vector<double>(ns.energy_range, -numeric_limits<double>::infinity());
+  removals = vector<long>(ns.energy_range, 0);
+}
+
+// run one iteration, lowering the threshold and replacing all removed live states
+void nested_sampling::iterate(uniform_real_distribution<double>& rnd,
+                              mt19937_64& generator) {
+  assert(!done);
+  const int live_points = live_states.size();
+  const int batch = generators.size();
+
+  // the new threshold is the energy of the (batch)-th highest live state
+  vector<int> sorted_energies = live_energies;
+  nth_element(sorted_energies.begin(), sorted_energies.begin() + batch - 1,
+              sorted_energies.end(), greater<int>());
+  const int threshold = sorted_energies[batch - 1];
+
+  // identify all live states at or above the threshold, and count them at every energy
+  vector<int> removed_points;
+  vector<int> surviving_points;
+  map<int, int> removed_counts;
+  for (int kk = 0; kk < live_points; kk++) {
+    if (live_energies[kk] >= threshold) {
+      removed_points.push_back(kk);
+      removed_counts[live_energies[kk]]++;
+      removals[live_energies[kk]]++;
+    } else {
+      surviving_points.push_back(kk);
+    }
+  }
+  const int removed = removed_points.size();
+
+  // split the volume we remove between the energies of the removed live states,
+  //   adding it to the volume we have already removed at these energies
+  // if we have removed all live states, we remove all of the remaining volume
+  for (const pair<const int, int>& energy_count : removed_counts) {
+    const double ln_volume_here = (ln_volume + log(double(energy_count.second)) -
+                                   log(double(surviving_points.empty() ?
+                                              removed : live_points)));
+    double& ln_total = ln_removed_volume[energy_count.first];
+    const double ln_max = max(ln_total, ln_volume_here);
+    ln_total = ln_max + log(exp(ln_total - ln_max) + exp(ln_volume_here - ln_max));
+  }
+  iterations++;
+  if (surviving_points.empty()) {
+    done = true;
+    return;
+  }
+  ln_volume += log(double(live_points - removed) / live_points);
+
+  // replace every removed live state by a copy of a random surviving live state
+  for (const int kk : removed_points) {
+    const int source = surviving_points[floor(rnd(generator) * surviving_points.size())];
+    live_states[kk] = live_states[source];
+    live_energies[kk] = live_energies[source];
+  }
+
+  // walk all replacement states below the threshold, splitting them between threads
+  const int thread_number = min(batch, removed);
+  vector<vector<int>> thread_points(thread_number);
+  for (int rr = 0; rr < removed; rr++) {
+    thread_points[rr % thread_number].push_back(removed_points[rr]);
+  }
+  vector<thread> threads;
+  for (int tt = 0; tt < thread_number; tt++) {
+    threads.push_back(thread(&nested_sampling::walk, this, cref(thread_points[tt]),
+                             threshold, ref(generators[tt])));
+  }
+  for (thread& walk_thread : threads) {
+    walk_thread.join();
+  }
+}
+
+// random walks of a list of live states among states with energies below a threshold
+void nested_sampling::walk(const vector<int>& live_points, const int threshold,
+                           mt19937_64& generator) {
+  uniform_real_distribution<double> rnd;
+  for (const int kk : live_points) {
+    vector<bool>& state = live_states[kk];
+    int& energy = live_energies[kk];
+    assert(energy < threshold);
+    for (long mm = 0; mm < walk_moves; mm++) {
+      const int node = floor(rnd(generator) * ns.network.nodes);
+      const int energy_change = ns.node_flip_energy_change(state, node);
+      if (energy + energy_change < threshold) {
+        state[node] = !state[node];
+        energy += energy_change;
+      }
+    }
+  }
+}
+
+// write the density of states into a simulation object
+void nested_sampling::export_dos(network_simulation& target) const {
+  const int energy_range = ns.energy_range;
+  target.energy_histogram = removals;
+
+  // the density of states at every energy is 2^nodes times the volume at that energy
+  target.ln_dos = vector<double>(energy_range, 0);
+  int last_seen_energy = -1;
+  for (int ee = 0; ee < energy_range; ee++) {
+    if (removals[ee] == 0) continue;
+    target.ln_dos[ee] = ns.network.nodes * log(2) + ln_removed_volume[ee];
+
+    // interpolate between this energy and the last one we have seen,
+    //   or extend the density of states below the lowest seen energy
+    if (last_seen_energy < 0) {
+      for (int unseen_ee = 0; unseen_ee < ee; unseen_ee++) {
+        target.ln_dos[unseen_ee] = target.ln_dos[ee];
+      }
+    } else {
+      for (int unseen_ee = last_seen_energy + 1; unseen_ee < ee; unseen_ee++) {
+        const double fraction = (double(unseen_ee - last_seen_energy)
+                                 / (ee - last_seen_energy));
+        target.ln_dos[unseen_ee] = ((1 - fraction) * target.ln_dos[last_seen_energy]
+                                    + fraction * target.ln_dos[ee]);
+      }
+    }
+    last_seen_energy = ee;
+  }
+  assert(last_seen_energy >= 0);
+  for (int ee = last_seen_energy + 1; ee < energy_range; ee++) {
+    target.ln_dos[ee] = target.ln_dos[last_seen_energy];
+  }
+
+  // locate the entropy peak, and normalize the density of states to zero at the peak
+  target.entropy_peak = last_seen_energy;
+  for (int ee = 0; ee < energy_range; ee++) {
+    if (removals[ee] > 0 && target.ln_dos[ee] > target.ln_dos[target.entropy_peak]) {
+      target.entropy_peak = ee;
+    }
+  }
+  const double max_ln_dos = target.ln_dos[target.entropy_peak];
+  for (int ee = 0; ee < energy_range; ee++) {
+    target.ln_dos[ee] -= max_ln_dos;
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <random> // for randomness
+
+#include "methods.h"
+
+using namespace std;
+
+// nested sampling of the density of states of a network simulation
+// we keep a number of "live" states sampled uniformly from all states with energies
+//   below a threshold, which starts above all energies; on every iteration we lower the
+//   threshold to the energy of the (batch)-th highest live state, remove all live states
+//   at or above the new threshold, and replace each of them by a copy of a random
+//   surviving live state, which then takes a random walk among states below the new
+//   threshold (in order to sample them uniformly)
+// if we remove n out of K live states, the fraction of the states below the old
+//   threshold which lie below the new threshold is (on average) (K - n) / K, so the
+//   logarithm of the volume (i.e. fraction of all states) below the threshold
+//   decreases by ln(K / (K - n)); the volume we removed is split between the energies
+//   of the removed states in proportion to the number of states we removed at each
+//   energy
+// the random walks of all replacement states are split between threads, and we remove
+//   at least (batch) = (number of threads) live states on every iteration
+struct nested_sampling {
+
+  // simulation which provides the network and energy range,
+  //   and into which we export the density of states
+  const network_simulation& ns;
+
+  // number of moves in every random walk
+  const long walk_moves;
+
+  // live states and their energies
+  vector<vector<bool>> live_states;
+  vector<int> live_energies;
+
+  // random number generators used by the threads which run the random walks
+  vector<mt19937_64> generators;
+
+  // logarithm of the volume below the current threshold
+  double ln_volume = 0;
+
+  // logarithm of the volume at every energy which we have removed so far,
+  //   and the number of live states we have removed at every energy
+  vector<double> ln_removed_volume;
+  vector<long> removals;
+
+  // number of iterations so far, and are we done? (i.e. have we removed all live states)
+  long iterations = 0;
+  bool done = false;
+
+  // constructor: live states start in random (i.e. uniformly sampled) states, and the
+  //   random number generator of thread tt is seeded by (seed, tt)
+  nested_sampling(const network_simulation& ns, const int live_points,
+                  const long walk_moves, const int threads, const long seed);
+
+  // run one iteration, lowering the threshold and replacing all removed live states
+  void iterate(uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // random walks of a list of live states among states with energies below a threshold,
+  //   every move of which is accepted if and only if it stays below the threshold
+  // note: this method only modifies the given live states, so it can run in
+  //   concurrent threads on disjoint lists
+  void walk(const vector<int>& live_points, const int threshold, mt19937_64& generator);
+
+  // write the density of states into a simulation object, and mark every energy we have
+  //   removed a live state at as seen in its energy histogram
+  // we interpolate (the logarithm of) the density of states linearly between seen
+  //   energies, and extend it as a constant past the lowest and highest seen energies
+  void export_dos(network_simulation& target) const;
+
+};
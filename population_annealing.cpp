@@ -0,0 +1,242 @@
+#include <iostream> // for standard output
+#include <iomanip> // for io manipulation (e.g. setprecision)
+#include <fstream> // for stream objects
+#include <random> // for randomness
+#include <cassert> // for assertions
+#include <algorithm> // for min and max
+#include <thread> // for multithreading
+#include <functional> // for ref
+
+#include "methods.h"
+#include "population_annealing.h"
+
+using namespace std;
+
+// constructor: the population starts in random states
+population_annealing::population_annealing(const network_simulation& ns,
+                                           const int target_population,
+                                           const int sweeps, const int steps,
+                                           const double final_input_temp,
+                                           const int threads, const long seed) :
+  ns(ns),
+  target_population(target_population),
+  sweeps(sweeps)
+{
+  assert(target_population > 0 && sweeps > 0 && steps > 0 && threads > 0);
+  assert(final_input_temp > 0);
+  input_betas = vector<double>(steps + 1);
+  for (int kk = 0; kk <= steps; kk++) {
+    input_betas[kk] = double(kk) / steps / final_input_temp;
+  }
+
+  for (int tt = 0; tt < min(threads, target_population); tt++) {
+    seed_seq thread_seed = { seed, long(tt) };
+    generators.push_back(mt19937_64(thread_seed));
+  }
+  uniform_real_distribution<double> rnd;
+  for (int rr = 0; rr < target_population; rr++) {
+    states.push_back(random_state(ns.network.nodes, rnd,
+                                  generators[rr % generators.size()]));
+    energies.push_back(ns.energy(states[rr]));
+  }
+}
+
+// run one step of the schedule, and record data from the resulting population
+void population_annealing::run_step(const int step, uniform_real_distribution<double>& rnd,
+                                    mt19937_64& generator) {
+  assert(step >= 0 && step < int(input_betas.size()));
+  assert(step == int(populations.size()));
+  const int nodes = ns.network.nodes;
+  const double input_beta = input_betas[step];
+
+  // at infinite temperature, all 2^nodes states are equally likely
+  if (step == 0) {
+    ln_partition_functions.push_back(nodes * log(2));
+  } else {
+    // resample the population: replica rr has a (relative) weight
+    //   w_rr = exp(-(beta_k - beta_{k-1}) E_rr), and the expected number of its copies
+    //   in the new population is target_population * w_rr / \sum_rr w_rr,
+    //   which we round up or down at random
+    // the mean weight (1/R) \sum_rr w_rr is the ratio of partition functions Z_k/Z_{k-1}
+    // note: we offset all energies by the lowest energy in the population
+    //   in order to avoid numerical overflows
+    const double delta_beta = (input_beta - input_betas[step-1]) / nodes;
+    const int population = states.size();
+    const int lowest_energy = *min_element(energies.begin(), energies.end());
+    vector<double> weights(population);
+    double weight_sum = 0;
+    for (int rr = 0; rr < population; rr++) {
+      weights[rr] = exp(-delta_beta * (energies[rr] - lowest_energy)
+                        * ns.network.energy_scale);
+      weight_sum += weights[rr];
+    }
+    ln_partition_functions.push_back(ln_partition_functions.back()
+                                     + log(weight_sum / population)
+                                     - delta_beta * ns.actual_energy(lowest_energy));
+
+    vector<vector<bool>> new_states;
+    vector<int> new_energies;
+    for (int rr = 0; rr < population; rr++) {
+      const double expected_copies = target_population * weights[rr] / weight_sum;
+      int copies = floor(expected_copies);
+      if (rnd(generator) < expected_copies - copies) copies++;
+      for (int cc = 0; cc < copies; cc++) {
+        new_states.push_back(states[rr]);
+        new_energies.push_back(energies[rr]);
+      }
+    }
+    states = new_states;
+    energies = new_energies;
+  }
+
+  // run sweeps on all replicas, splitting them between threads
+  const int population = states.size();
+  const int thread_number = min(int(generators.size()), population);
+  vector<thread> threads;
+  for (int tt = 0; tt < thread_number; tt++) {
+    const int first_replica = long(tt) * population / thread_number;
+    const int end_replica = long(tt + 1) * population / thread_number;
+    threads.push_back(thread(&population_annealing::run_sweeps, this,
+                             first_replica, end_replica, input_beta,
+                             ref(generators[tt])));
+  }
+  for (thread& sweep_thread : threads) {
+    sweep_thread.join();
+  }
+
+  // record data from the population
+  populations.push_back(population);
+  energy_histograms.push_back(vector<long>(ns.energy_range, 0));
+  double energy_log = 0;
+  double squared_energy_log = 0;
+  long distance_log = 0;
+  for (int rr = 0; rr < population; rr++) {
+    const double energy = ns.actual_energy(energies[rr]);
+    energy_log += energy;
+    squared_energy_log += energy * energy;
+    energy_histograms[step][energies[rr]]++;
+
+    int min_distance = nodes;
+    for (int pp = 0; pp < ns.pattern_number; pp++) {
+      int overlap = 0;
+      for (int ii = 0; ii < nodes; ii++) {
+        overlap += (states[rr][ii] == ns.patterns[pp][ii]);
+      }
+      min_distance = min({min_distance, overlap, nodes - overlap});
+    }
+    distance_log += min_distance;
+  }
+  energy_logs.push_back(energy_log);
+  squared_energy_logs.push_back(squared_energy_log);
+  distance_logs.push_back(distance_log);
+}
+
+// run sweeps over a range of replicas at a given (input) temperature
+void population_annealing::run_sweeps(const int first_replica, const int end_replica,
+                                      const double input_beta, mt19937_64& generator) {
+  uniform_real_distribution<double> rnd;
+  const int nodes = ns.network.nodes;
+  const long moves = long(sweeps) * nodes;
+
+  // at infinite temperature, we accept every move
+  if (input_beta == 0) {
+    for (int rr = first_replica; rr < end_replica; rr++) {
+      for (long mm = 0; mm < moves; mm++) {
+        const int node = floor(rnd(generator) * nodes);
+        energies[rr] += ns.node_flip_energy_change(states[rr], node);
+        states[rr][node] = !states[rr][node];
+      }
+    }
+    return;
+  }
+
+  // simulation temperature in the same units as those used for our energies,
+  //   and acceptance probabilities for all possible energy changes
+  const double temp = nodes / input_beta / ns.network.energy_scale;
+  vector<double> move_probabilities(2*ns.max_de + 1);
+  for (int de = -ns.max_de; de <= ns.max_de; de++) {
+    move_probabilities[de + ns.max_de] = exp(-de/temp);
+  }
+  for (int rr = first_replica; rr < end_replica; rr++) {
+    vector<bool>& state = states[rr];
+    int& energy = energies[rr];
+    for (long mm = 0; mm < moves; mm++) {
+      const int node = floor(rnd(generator) * nodes);
+      const double acceptance_draw = rnd(generator);
+      int energy_change;
+      if (ns.node_flip_energy_change(state, node, temp, acceptance_draw, energy_change) &&
+          acceptance_draw < move_probabilities[energy_change + ns.max_de]) {
+        state[node] = !state[node];
+        energy += energy_change;
+      }
+    }
+    assert(energy >= 0 && energy < ns.energy_range);
+  }
+}
+
+// logarithm of the density of states at every energy
+vector<double> population_annealing::ln_dos() const {
+  const int steps = populations.size();
+  const int nodes = ns.network.nodes;
+  vector<double> ln_dos(ns.energy_range, -numeric_limits<double>::infinity());
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    long samples = 0;
+    for (int kk = 0; kk < steps; kk++) {
+      samples += energy_histograms[kk][ee];
+    }
+    if (samples == 0) continue;
+
+    // compute ln \sum_k R_k exp(-beta_k E) / Z_k, offsetting all terms by the largest
+    //   one in order to avoid numerical overflows
+    const double energy = ns.actual_energy(ee);
+    vector<double> ln_terms(steps);
+    for (int kk = 0; kk < steps; kk++) {
+      ln_terms[kk] = (log(populations[kk]) - input_betas[kk] * energy / nodes
+                      - ln_partition_functions[kk]);
+    }
+    const double max_ln_term = *max_element(ln_terms.begin(), ln_terms.end());
+    double term_sum = 0;
+    for (int kk = 0; kk < steps; kk++) {
+      term_sum += exp(ln_terms[kk] - max_ln_term);
+    }
+    ln_dos[ee] = log(samples) - max_ln_term - log(term_sum);
+  }
+  return ln_dos;
+}
+
+// ---------------------------------------------------------------------------------------
+// Writing data files
+// ---------------------------------------------------------------------------------------
+
+void population_annealing::write_population_file(const string population_file,
+                                                 const string file_header) const {
+  ofstream population_stream(population_file);
+  population_stream << file_header << endl
+                    << "# input_temp, population, ln_partition_function,"
+                    << " energy log, squared energy log, distance log" << endl;
+  for (int kk = 0, steps = populations.size(); kk < steps; kk++) {
+    population_stream << setprecision(numeric_limits<double>::max_digits10)
+                      << (input_betas[kk] > 0 ? 1 / input_betas[kk] :
+                          numeric_limits<double>::infinity()) << " "
+                      << populations[kk] << " "
+                      << ln_partition_functions[kk] << " "
+                      << energy_logs[kk] << " "
+                      << squared_energy_logs[kk] << " "
+                      << distance_logs[kk] << endl;
+  }
+  population_stream.close();
+}
+
+void population_annealing::write_dos_file(const string dos_file,
+                                          const string file_header) const {
+  const vector<double> dos = ln_dos();
+  ofstream dos_stream(dos_file);
+  dos_stream << file_header << endl
+             << "# energy, ln_dos" << endl;
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    if (dos[ee] == -numeric_limits<double>::infinity()) continue;
+    dos_stream << setprecision(numeric_limits<double>::max_digits10)
+               << ns.actual_energy(ee) << " " << dos[ee] << endl;
+  }
+  dos_stream.close();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <random> // for randomness
+
+#include "methods.h"
+
+using namespace std;
+
+// population annealing of a network: a population of replicas (network states) starts
+//   at infinite temperature, and is cooled along a schedule of temperatures; on every
+//   step of the schedule, we resample the population according to the change in the
+//   boltzmann weights of its replicas, and then run metropolis sweeps on every replica
+//   at the new temperature, with replicas split between threads
+// the normalizations of the resampling weights give us the partition function at every
+//   temperature of the schedule, from which (together with the energy histograms of the
+//   population at every temperature) we also estimate the density of states
+// note: unlike everywhere else, temperatures here are input temperatures, and energies
+//   in all recorded data are "actual" energies
+struct population_annealing {
+
+  // simulation which provides the network, patterns, and energy range
+  const network_simulation& ns;
+
+  // annealing schedule, in the units of the input temperature, which starts at an
+  //   infinite temperature (stored as zero inverse temperature)
+  vector<double> input_betas;
+
+  // the population size we aim for, and the number of sweeps (i.e. moves per node)
+  //   per replica on every step of the schedule
+  const int target_population;
+  const int sweeps;
+
+  // current replica states and their energies (indices)
+  vector<vector<bool>> states;
+  vector<int> energies;
+
+  // random number generators used by the threads which run the sweeps
+  vector<mt19937_64> generators;
+
+  // data recorded at every step of the schedule:
+  //   the population size, the logarithm of the partition function,
+  //   the sums of all (squared) energies and distances from the nearest pattern
+  //   in the population, and a histogram of the energies in the population
+  vector<int> populations;
+  vector<double> ln_partition_functions;
+  vector<double> energy_logs;
+  vector<double> squared_energy_logs;
+  vector<long> distance_logs;
+  vector<vector<long>> energy_histograms;
+
+  // constructor: the population starts in random states, and the random number
+  //   generator of thread tt is seeded by (seed, tt)
+  // the schedule runs over a given number of steps from infinite temperature down to
+  //   a final (input) temperature, in equal steps of inverse temperature
+  population_annealing(const network_simulation& ns, const int target_population,
+                       const int sweeps, const int steps, const double final_input_temp,
+                       const int threads, const long seed);
+
+  // run one step of the schedule (or, on step zero, equilibriate at infinite
+  //   temperature), and record data from the resulting population
+  void run_step(const int step, uniform_real_distribution<double>& rnd,
+                mt19937_64& generator);
+
+  // run sweeps over a range of replicas at a given (input) temperature
+  // note: this method only modifies the given range of replicas, so it can run in
+  //   concurrent threads on disjoint ranges
+  void run_sweeps(const int first_replica, const int end_replica, const double input_beta,
+                  mt19937_64& generator);
+
+  // (natural) logarithm of the density of states at every energy, combining the energy
+  //   histograms at all steps of the schedule via
+  //   g(E) = \sum_k H_k(E) / \sum_k R_k exp(-beta_k E) / Z_k,
+  //   where H_k, R_k, and Z_k are the energy histogram, population size, and partition
+  //   function at step k; energies which we have never seen have ln_dos = -infinity
+  vector<double> ln_dos() const;
+
+  // write data files
+  void write_population_file(const string population_file,
+                             const string file_header) const;
+  void write_dos_file(const string dos_file, const string file_header) const;
+
+};
@@ -3,12 +3,23 @@
 #include <random> // for randomness
 #include <fstream> // for file input
 #include <ctime> // for keeping track of runtime
+#include <algorithm> // for sort and find
+#include <thread> // for multithreading
+#include <functional> // for ref and function objects
 
 #include <boost/filesystem.hpp> // filesystem path manipulation library
 #include <boost/program_options.hpp> // options parsing library
 #include <boost/functional/hash.hpp> // for hashing methods
 
 #include "methods.h"
+#include "multispin.h"
+#include "tiny_networks.h"
+#include "tempering.h"
+#include "wang_landau.h"
+#include "dos_solver.h"
+#include "ground_state.h"
+#include "population_annealing.h"
+#include "nested_sampling.h"
 
 using namespace std;
 namespace bo = boost;
@@ -62,6 +73,15 @@ int main(const int arg_num, const char *arg_vec[]) {
   int log10_iterations;
   int init_factor;
   int print_time;
+  int replicas;
+  int networks;
+  vector<double> temp_ladder;
+  long swap_interval;
+  int tune_ladder;
+  bool tuned_ladder;
+  vector<double> lambda_ladder;
+  double pattern_move_ratio;
+  bool autocorrelation;
 
   po::options_description simulation_options("General simulation options",
                                              help_text_length);
@@ -75,10 +95,59 @@ int main(const int arg_num, const char *arg_vec[]) {
      "set iterations per inialozation cycle to [pattern_number] * 10^(init_factor)")
     ("print_time", po::value<int>(&print_time)->default_value(30),
      "time (in minutes) between intermediate data file dumps")
+    ("replicas", po::value<int>(&replicas)->default_value(1),
+     "number of replicas to simulate simultaneously (using multi-spin coding)"
+     " in a fixed-temperature simulation")
+    ("networks", po::value<int>(&networks)->default_value(1),
+     "number of independent networks (of at most 64 nodes) with different random"
+     " patterns to simulate at once in a fixed-temperature simulation")
+    ("temp_ladder", po::value<vector<double>>(&temp_ladder)->multitoken(),
+     "temperatures at which to run a fixed-temperature parallel tempering simulation"
+     " (with one replica per temperature and thread); overrides --temp")
+    ("swap_interval", po::value<long>(&swap_interval)->default_value(0,"nodes"),
+     "number of moves between attempts to swap replicas in parallel tempering")
+    ("tune_ladder", po::value<int>(&tune_ladder)->default_value(0),
+     "number of feedback iterations (of one initialization cycle each) for which to tune"
+     " the (increasing) temperature ladder, after which we write it to a file and exit")
+    ("tuned_ladder",
+     po::value<bool>(&tuned_ladder)->default_value(false)->implicit_value(true),
+     "run parallel tempering with the temperature ladder previously tuned for this network")
+    ("lambda_ladder", po::value<vector<double>>(&lambda_ladder)->multitoken(),
+     "scales (starting at 1) of the contribution of the last pattern to the energy, at"
+     " which to run a fixed-temperature hamiltonian replica exchange simulation"
+     " (with one replica per scale and thread), recording data only at scale 1")
+    ("pattern_move_ratio", po::value<double>(&pattern_move_ratio)->default_value(0),
+     "fraction of simulation moves which flip a random subset of the nodes on which the"
+     " state disagrees with a random pattern (or its inverse), rather than a single node")
+    ("autocorrelation",
+     po::value<bool>(&autocorrelation)->default_value(false)->implicit_value(true),
+     "measure the autocorrelation times of the energy and pattern overlaps"
+     " during the simulation, and report them per CPU second")
     ;
 
   bool only_init;
   double target_sample_error;
+  int init_walkers;
+  int ground_state_restarts;
+  int population;
+  int anneal_steps;
+  int anneal_sweeps;
+  bool pattern_sweep;
+  bool adaptive_cycles;
+  int coarse_bins;
+  bool mean_field_seed;
+  bool reuse_weights;
+  bool rebuild_weights;
+  bool two_sided;
+  string init_method;
+  int rewl_windows;
+  int rewl_walkers;
+  int rewl_preliminary_cycles;
+  int nested_live_points;
+  int nested_walk_sweeps;
+  string dos_solver;
+  int window_lo = numeric_limits<int>::min();
+  int window_hi = numeric_limits<int>::max();
 
   po::options_description all_temps_options("All temperature simulation options",
                                             help_text_length);
@@ -88,6 +157,86 @@ int main(const int arg_num, const char *arg_vec[]) {
     ("sample_error", po::value<double>(&target_sample_error)->default_value(0.02,"0.02"),
      "the initialization routine terminates when it achieves this"
      " expected fractional sample error at the simulation temperature")
+    ("adaptive_cycles",
+     po::value<bool>(&adaptive_cycles)->default_value(false)->implicit_value(true),
+     "adapt the length of initialization cycles to the observed decay of the sample"
+     " error, sizing them to approach the target sample error with bounded overshoot")
+    ("coarse_bins", po::value<int>(&coarse_bins)->default_value(1),
+     "initial width of the energy bins in transition matrix initialization; whenever"
+     " we reach the target sample error with some bin width, we halve it, until we"
+     " reach the target with a bin width of 1 (i.e. with individual energies)")
+    ("mean_field_seed",
+     po::value<bool>(&mean_field_seed)->default_value(false)->implicit_value(true),
+     "seed the density of states with a gaussian estimate from the moments of the"
+     " couplings, which the initialization routine uses when it lacks data")
+    ("two_sided", po::value<bool>(&two_sided)->default_value(false)->implicit_value(true),
+     "initialize weights on both sides of the entropy peak, down to temperatures of"
+     " magnitude |temp| on either side, which cover both positive and negative"
+     " temperatures")
+    ("reuse_weights", po::value<bool>(&reuse_weights)->default_value(true),
+     "if we have no weights for this simulation, use the weights of an earlier"
+     " simulation of the same patterns at a temperature of the same sign and at most"
+     " the same magnitude (with at most the same target sample error)")
+    ("rebuild_weights",
+     po::value<bool>(&rebuild_weights)->default_value(false)->implicit_value(true),
+     "initialize (and overwrite) the weights of a simulation even if we already have"
+     " weights for it, or could reuse those of another simulation")
+    ("init_walkers", po::value<int>(&init_walkers)->default_value(1),
+     "number of walkers (each in its own thread) which split the moves of every"
+     " initialization cycle, and share all data collected during initialization"
+     " (merging their data and computing the density of states after every cycle"
+     " is serial, which limits the speedup)")
+    ("ground_state_restarts", po::value<int>(&ground_state_restarts)->default_value(0),
+     "before initialization, search for the ground state with this many restarts of"
+     " simulated annealing and tabu search (split between all available threads);"
+     " initialization then starts from the best state found, and samples its energy"
+     " before it is done")
+    ("population", po::value<int>(&population)->default_value(0),
+     "in place of the all-temperature simulation, run population annealing with"
+     " (about) this many replicas, cooling them from infinite temperature down to the"
+     " simulation temperature")
+    ("anneal_steps", po::value<int>(&anneal_steps)->default_value(100),
+     "number of (equal) steps in inverse temperature in population annealing")
+    ("anneal_sweeps", po::value<int>(&anneal_sweeps)->default_value(10),
+     "number of sweeps (i.e. moves per node) per replica on every step of"
+     " population annealing")
+    ("pattern_sweep",
+     po::value<bool>(&pattern_sweep)->default_value(false)->implicit_value(true),
+     "initialize the all-temperature simulations of the networks with the first"
+     " 1, 2, ..., [patterns] patterns in turn, writing the weights of each (unless we"
+     " already have them), and exit; every network starts from the state and density"
+     " of states of the last one we initialize")
+    ("init_method", po::value<string>(&init_method)->default_value("transitions"),
+     "initialization method: 'transitions' (transition matrix sampling)"
+     ", 'rewl' (replica-exchange wang-landau sampling in energy windows),"
+     " 'wl1t' (wang-landau sampling with a 1/t schedule),"
+     " or 'nested' (nested sampling at positive temperatures, with one thread per"
+     " initialization walker)")
+    ("rewl_windows", po::value<int>(&rewl_windows)->default_value(4),
+     "number of energy windows in replica-exchange wang-landau sampling")
+    ("rewl_walkers", po::value<int>(&rewl_walkers)->default_value(0,"rewl_windows"),
+     "total number of walkers (each in its own thread) in replica-exchange wang-landau"
+     " sampling, which are allocated to windows according to their convergence")
+    ("rewl_preliminary_cycles",
+     po::value<int>(&rewl_preliminary_cycles)->default_value(10),
+     "number of transition matrix sampling cycles used to find the range of energies"
+     " for replica-exchange wang-landau sampling")
+    ("nested_live_points", po::value<int>(&nested_live_points)->default_value(1000),
+     "number of live states in nested sampling")
+    ("nested_walk_sweeps", po::value<int>(&nested_walk_sweeps)->default_value(10),
+     "number of sweeps (i.e. moves per node) in the random walk of every new live state"
+     " in nested sampling")
+    ("dos_solver", po::value<string>(&dos_solver)->default_value("sweep"),
+     "method for computing the density of states from transition matrix data:"
+     " 'sweep' (detailed balance between neighboring energies, sweeping out from the"
+     " entropy peak) or 'global' (least-squares fit to all detailed balance conditions,"
+     " applied to the final estimate only); 'global' does not take fewer"
+     " initialization cycles, but gives a more accurate density of states")
+    ("energy_window_lo", po::value<int>(&window_lo),
+     "lowest energy of a window to which we confine both initialization and simulation,"
+     " rejecting all moves out of the window")
+    ("energy_window_hi", po::value<int>(&window_hi),
+     "highest energy of a window to which we confine both initialization and simulation")
     ;
 
   string data_dir;
@@ -140,6 +289,177 @@ int main(const int arg_num, const char *arg_vec[]) {
   if (pattern_number == 0) pattern_number = nodes;
 
   assert(log10_iterations > 0);
+
+  // multi-spin coding stores (at most 64) replicas in the bits of a machine word,
+  //   and is only implemented for fixed-temperature simulations
+  if (replicas != 1 && (!fixed_temp || replicas < 1 ||
+                        replicas > multispin_simulation::max_replicas)) {
+    cout << "multiple replicas (at most " << multispin_simulation::max_replicas
+         << ") are only supported in fixed-temperature simulations" << endl;
+    return -1;
+  }
+
+  // simulating many independent networks at once requires (at most 64-node) networks
+  //   with random patterns, and is only implemented for fixed-temperature simulations
+  if (networks != 1 && (!fixed_temp || networks < 1 || replicas != 1
+                        || nodes > tiny_network_batch::max_nodes
+                        || !pattern_file.empty())) {
+    cout << "multiple networks are only supported in fixed-temperature simulations"
+         << " of networks with at most " << tiny_network_batch::max_nodes
+         << " nodes and random patterns" << endl;
+    return -1;
+  }
+
+  // parallel tempering requires at least two distinct (nonzero) temperatures,
+  //   and is only implemented for fixed-temperature simulations of one network
+  if (!temp_ladder.empty()) {
+    vector<double> sorted_ladder = temp_ladder;
+    sort(sorted_ladder.begin(), sorted_ladder.end());
+    if (!fixed_temp || replicas != 1 || networks != 1 || temp_ladder.size() < 2
+        || adjacent_find(sorted_ladder.begin(), sorted_ladder.end()) != sorted_ladder.end()
+        || find(temp_ladder.begin(), temp_ladder.end(), 0) != temp_ladder.end()) {
+      cout << "parallel tempering requires at least two distinct nonzero temperatures,"
+           << " and is only supported in fixed-temperature simulations"
+           << " of one replica of one network" << endl;
+      return -1;
+    }
+    input_temp = temp_ladder[0];
+  }
+
+  // hamiltonian replica exchange requires a ladder of at least two distinct scales in
+  //   [0, 1] starting at 1, and is only implemented for fixed-temperature
+  //   simulations of one replica of one network
+  if (!lambda_ladder.empty()) {
+    vector<double> sorted_ladder = lambda_ladder;
+    sort(sorted_ladder.begin(), sorted_ladder.end());
+    if (!fixed_temp || replicas != 1 || networks != 1 || !temp_ladder.empty()
+        || tuned_ladder || tune_ladder != 0
+        || lambda_ladder.size() < 2 || lambda_ladder[0] != 1 || sorted_ladder[0] < 0
+        || sorted_ladder.back() > 1
+        || adjacent_find(sorted_ladder.begin(), sorted_ladder.end()) != sorted_ladder.end()) {
+      cout << "hamiltonian replica exchange requires at least two distinct scales in"
+           << " [0, 1] starting at 1, and is only supported in fixed-temperature"
+           << " simulations of one replica of one network" << endl;
+      return -1;
+    }
+  }
+
+  // pattern-directed moves are only implemented in simulations of one replica
+  //   of one network
+  if (pattern_move_ratio < 0 || pattern_move_ratio > 1) {
+    cout << "the pattern move ratio must be in [0, 1]" << endl;
+    return -1;
+  }
+  if ((pattern_move_ratio > 0 || autocorrelation)
+      && (replicas != 1 || networks != 1 || !temp_ladder.empty() || tuned_ladder
+          || tune_ladder != 0 || !lambda_ladder.empty())) {
+    cout << "pattern moves and autocorrelation measurements are only supported"
+         << " in simulations of one walker, replica, and network" << endl;
+    return -1;
+  }
+
+  // the ladder we tune must be increasing, and we can only run with a tuned ladder
+  //   if we do not specify another one
+  if (tune_ladder != 0 && (tune_ladder < 0 || temp_ladder.empty()
+                           || !is_sorted(temp_ladder.begin(), temp_ladder.end()))) {
+    cout << "tuning a temperature ladder requires an increasing ladder" << endl;
+    return -1;
+  }
+  if (tuned_ladder && (!fixed_temp || !temp_ladder.empty() || tune_ladder != 0
+                       || replicas != 1 || networks != 1)) {
+    cout << "a tuned temperature ladder can only be used in place of --temp_ladder"
+         << endl;
+    return -1;
+  }
+  if (init_method != "transitions" && init_method != "rewl" && init_method != "wl1t"
+      && init_method != "nested") {
+    cout << "unknown initialization method: " << init_method << endl;
+    return -1;
+  }
+  if (init_method != "transitions" && fixed_temp) {
+    cout << "initialization methods only apply to all-temperature simulations" << endl;
+    return -1;
+  }
+  if (dos_solver != "sweep" && dos_solver != "global") {
+    cout << "unknown density of states solver: " << dos_solver << endl;
+    return -1;
+  }
+  if (coarse_bins < 1) {
+    cout << "energy bins must have a width of at least 1" << endl;
+    return -1;
+  }
+  if (coarse_bins > 1 && init_method != "transitions") {
+    cout << "coarse energy bins are only supported in transition matrix initialization"
+         << endl;
+    return -1;
+  }
+  if (two_sided && (fixed_temp || init_method != "transitions")) {
+    cout << "two-sided weights are only supported in transition matrix initialization"
+         << " of all-temperature simulations" << endl;
+    return -1;
+  }
+  const bool use_energy_window
+    = inputs.count("energy_window_lo") || inputs.count("energy_window_hi");
+  if (use_energy_window && (fixed_temp || init_method != "transitions")) {
+    cout << "energy windows are only supported in transition matrix initialization"
+         << " of all-temperature simulations" << endl;
+    return -1;
+  }
+  if (window_lo > window_hi) {
+    cout << "the energy window should not be empty" << endl;
+    return -1;
+  }
+  assert(rewl_windows > 0);
+  assert(rewl_walkers >= 0);
+  assert(rewl_preliminary_cycles > 0);
+  if (init_walkers < 1) {
+    cout << "we need at least one initialization walker" << endl;
+    return -1;
+  }
+  if (init_method == "nested"
+      && (nested_live_points <= init_walkers || nested_walk_sweeps < 1)) {
+    cout << "nested sampling requires more live states than initialization walkers,"
+         << " and at least one sweep per random walk" << endl;
+    return -1;
+  }
+  // nested sampling only ever lowers its energy threshold, so it only samples the
+  //   density of states below the entropy peak
+  if (init_method == "nested" && input_temp <= 0) {
+    cout << "nested sampling only supports positive temperatures" << endl;
+    return -1;
+  }
+  if (ground_state_restarts < 0) {
+    cout << "the number of ground state search restarts cannot be negative" << endl;
+    return -1;
+  }
+  if (population < 0 || anneal_steps < 1 || anneal_sweeps < 1) {
+    cout << "population annealing requires a nonnegative population,"
+         << " and at least one step and sweep" << endl;
+    return -1;
+  }
+  if (population > 0 && (fixed_temp || input_temp <= 0 || use_energy_window)) {
+    cout << "population annealing replaces all-temperature simulations"
+         << " at positive temperatures, without an energy window" << endl;
+    return -1;
+  }
+  if (pattern_sweep && (fixed_temp || init_method != "transitions" || init_walkers != 1
+                        || coarse_bins != 1 || two_sided || use_energy_window
+                        || population > 0)) {
+    cout << "pattern sweeps only support all-temperature simulations with the"
+         << " standard single-walker initialization routine" << endl;
+    return -1;
+  }
+  if (pattern_sweep && (adaptive_cycles || ground_state_restarts > 0)) {
+    cout << "pattern sweeps do not support adaptive initialization cycles"
+         << " or ground state searches" << endl;
+    return -1;
+  }
+  if (ground_state_restarts > 0 && fixed_temp) {
+    cout << "a ground state search only applies to all-temperature simulations" << endl;
+    return -1;
+  }
+  if (swap_interval == 0) swap_interval = nodes;
+  assert(swap_interval > 0);
   assert(init_factor > 0);
 
   // make sure that iteration counters/factors aren't too large
@@ -207,6 +527,17 @@ int main(const int arg_num, const char *arg_vec[]) {
 
   }
 
+  // if we are simulating many independent networks, the first one uses the patterns
+  //   we just generated, and the rest use patterns which we generate now
+  vector<vector<vector<bool>>> network_patterns = { patterns };
+  for (int nn = 1; nn < networks; nn++) {
+    vector<vector<bool>> more_patterns;
+    for (int ii = 0; ii < pattern_number; ii++) {
+      more_patterns.push_back(random_state(nodes, rnd, generator));
+    }
+    network_patterns.push_back(more_patterns);
+  }
+
   // make sure that all patterns contain the same number of nodes
   for (int ii = 1, size = patterns.size(); ii < size; ii++) {
     if (patterns[ii-1].size() != patterns[ii].size()){
@@ -215,29 +546,100 @@ int main(const int arg_num, const char *arg_vec[]) {
     }
   }
 
+  // make a hash of the patterns alone to identify the network,
+  //   which we use to keep track of temperature ladders tuned for this network
+  auto patterns_hash = [&](const vector<vector<bool>>& hash_patterns) -> size_t {
+    size_t running_hash = 0;
+    for (const vector<bool>& pattern : hash_patterns) {
+      for (int nn = 0; nn < nodes; nn++) {
+        bo::hash_combine(running_hash, size_t(pattern[nn]));
+      }
+    }
+    return running_hash;
+  };
+  const size_t pattern_hash = patterns_hash(patterns);
+  const string ladder_file
+    = (fs::path(data_dir) / fs::path("ladder-N" + to_string(nodes)
+                                     + "-P" + to_string(pattern_number)
+                                     + "-h" + to_string(pattern_hash) + ".txt")).string();
+
+  // if we are using a tuned temperature ladder, read it in
+  if (tuned_ladder) {
+    if (!fs::exists(ladder_file)) {
+      cout << "no tuned temperature ladder found for this network:" << endl
+           << ladder_file << endl;
+      return -1;
+    }
+    ifstream input(ladder_file);
+    string line;
+    while (getline(input,line)) {
+      if (line.empty() || line[0] == '#') continue;
+      temp_ladder.push_back(stod(line));
+    }
+    input.close();
+    input_temp = temp_ladder[0];
+  }
+
   // make a hash of the temperature, patterns, and (if appropriate) target sample error
   //   to "identify" this simulation
-  const size_t hash = [&]() -> size_t {
+  // note: we also hash subsets of the patterns, in order to identify the simulations
+  //   of smaller networks in a pattern sweep
+  auto simulation_hash = [&](const vector<vector<bool>>& hash_patterns) -> size_t {
     size_t running_hash = input_temp;
-    for (int pp = 0; pp < pattern_number; pp++) {
+    for (const vector<bool>& pattern : hash_patterns) {
       for (int nn = 0; nn < nodes; nn++) {
-        bo::hash_combine(running_hash, size_t(patterns[pp][nn]));
+        bo::hash_combine(running_hash, size_t(pattern[nn]));
       }
     }
     if (!fixed_temp) {
       bo::hash_combine(running_hash, target_sample_error);
     }
+    if (two_sided) {
+      bo::hash_combine(running_hash, two_sided);
+    }
+    if (population > 0) {
+      bo::hash_combine(running_hash, population);
+      bo::hash_combine(running_hash, anneal_steps);
+      bo::hash_combine(running_hash, anneal_sweeps);
+    }
+    if (use_energy_window) {
+      bo::hash_combine(running_hash, window_lo);
+      bo::hash_combine(running_hash, window_hi);
+    }
+    if (replicas > 1) {
+      bo::hash_combine(running_hash, replicas);
+    }
+    if (networks > 1) {
+      bo::hash_combine(running_hash, networks);
+    }
+    for (const double ladder_temp : temp_ladder) {
+      bo::hash_combine(running_hash, ladder_temp);
+    }
+    for (const double lambda : lambda_ladder) {
+      bo::hash_combine(running_hash, lambda);
+    }
     return running_hash;
-  }();
+  };
+  const size_t hash = simulation_hash(patterns);
 
   // put together a suffix to tag all data files read/written by this simulation
-  const string temp_tag = ("-" + string(fixed_temp ? "f" : "") + "100T"
-                           + string(input_temp < 0 ? "n" : "")
-                           + to_string(int(round(100*input_temp))));
+  // parallel tempering simulations write data files for every temperature,
+  //   so we also define the suffix for a given temperature, and pattern sweeps write
+  //   data files for networks with a subset of the patterns, so we also define the
+  //   suffix for a given number of patterns and simulation hash
   const string node_tag = "-N" + to_string(nodes);
-  const string pattern_tag = "-P" + to_string(pattern_number);
-  const string file_suffix = (node_tag + pattern_tag + temp_tag
-                              + "-h" + to_string(hash) + ".txt");
+  auto network_suffix = [&](const int suffix_pattern_number, const double temp,
+                            const size_t suffix_hash) -> string {
+    const string temp_tag = ("-" + string(fixed_temp ? "f" : "") + "100T"
+                             + string(temp < 0 ? "n" : "")
+                             + to_string(int(round(100*temp))));
+    return (node_tag + "-P" + to_string(suffix_pattern_number) + temp_tag
+            + "-h" + to_string(suffix_hash) + ".txt");
+  };
+  auto temp_suffix = [&](const double temp) -> string {
+    return network_suffix(pattern_number, temp, hash);
+  };
+  const string file_suffix = temp_suffix(input_temp);
 
   // if all we were after was the suffix, print it and exit
   if (print_suffix) {
@@ -259,20 +661,124 @@ int main(const int arg_num, const char *arg_vec[]) {
 
   // construct network simulation object with a random initial state
   generator.seed(seed);
-  network_simulation ns(patterns, random_state(nodes, rnd, generator), fixed_temp);
-
-  // header for all data files
-  stringstream file_header_stream;
-  file_header_stream << "# nodes: " << ns.network.nodes << endl
-                     << "# patterns: " << ns.pattern_number << endl
-                     << "# input_temp: " << input_temp << endl
-                     << "# energy_scale: " << ns.network.energy_scale << endl
-                     << "# energy_range: " << ns.energy_range << endl
-                     << "# max_de: " << ns.max_de << endl;
-  if (!fixed_temp) {
-    file_header_stream << "# target_sample_error: " << target_sample_error << endl;
-  }
-  const string file_header = file_header_stream.str();
+  network_simulation ns(patterns, random_state(nodes, rnd, generator), fixed_temp,
+                        window_lo, window_hi);
+
+  // header for all data files written for the network of a given simulation at a given
+  //   temperature (pattern sweeps write data files for several networks)
+  auto network_file_header = [&](const network_simulation& ns,
+                                 const double temp) -> string {
+    stringstream file_header_stream;
+    file_header_stream << "# nodes: " << ns.network.nodes << endl
+                       << "# patterns: " << ns.pattern_number << endl
+                       << "# input_temp: " << temp << endl
+                       << "# energy_scale: " << ns.network.energy_scale << endl
+                       << "# energy_range: " << ns.energy_range << endl
+                       << "# max_de: " << ns.max_de << endl;
+    if (!fixed_temp) {
+      file_header_stream << "# target_sample_error: " << target_sample_error << endl
+                         << "# pattern_hash: " << patterns_hash(ns.patterns) << endl;
+    }
+    if (two_sided) {
+      file_header_stream << "# two_sided: " << two_sided << endl;
+    }
+    if (population > 0) {
+      file_header_stream << "# population: " << population << endl
+                         << "# anneal_steps: " << anneal_steps << endl
+                         << "# anneal_sweeps: " << anneal_sweeps << endl;
+    }
+    if (use_energy_window) {
+      file_header_stream << "# energy_window: " << ns.actual_energy(0) << " "
+                         << ns.actual_energy(ns.energy_range - 1) << endl;
+    }
+    if (replicas > 1) {
+      file_header_stream << "# replicas: " << replicas << endl;
+    }
+    if (networks > 1) {
+      file_header_stream << "# networks: " << networks << endl;
+    }
+    if (pattern_move_ratio > 0) {
+      file_header_stream << "# pattern_move_ratio: " << pattern_move_ratio << endl;
+    }
+    if (!temp_ladder.empty()) {
+      file_header_stream << "# temp_ladder:";
+      for (const double ladder_temp : temp_ladder) {
+        file_header_stream << " " << ladder_temp;
+      }
+      file_header_stream << endl
+                         << "# swap_interval: " << swap_interval << endl;
+    }
+    if (!lambda_ladder.empty()) {
+      file_header_stream << "# lambda_ladder:";
+      for (const double lambda : lambda_ladder) {
+        file_header_stream << " " << lambda;
+      }
+      file_header_stream << endl
+                         << "# swap_interval: " << swap_interval << endl;
+    }
+    return file_header_stream.str();
+  };
+  auto temp_file_header = [&](const double temp) -> string {
+    return network_file_header(ns, temp);
+  };
+  const string file_header = temp_file_header(input_temp);
+
+  // weights computed at some temperature T cover all temperatures T' with the same
+  //   sign (or either sign, for two-sided weights) and |T'| > |T|, so if we have no
+  //   weights for a simulation, look for the weights file of an earlier simulation
+  //   of the same patterns at a temperature of the same sign (or with two-sided
+  //   weights, if we need them) and at most the same magnitude, with at most the same
+  //   target sample error; of all such files, we pick the one with the highest |T|
+  auto find_reusable_weights = [&](const network_simulation& ns) -> string {
+    string best_file;
+    double best_temp = 0;
+    if (!fs::is_directory(data_dir)) return best_file;
+    const string window_tag = (!use_energy_window ? "" :
+                               to_string(ns.actual_energy(0)) + " "
+                               + to_string(ns.actual_energy(ns.energy_range - 1)));
+    const string prefix = "weights" + node_tag + "-P" + to_string(ns.pattern_number);
+    const size_t pattern_hash = patterns_hash(ns.patterns);
+    for (const fs::directory_entry& entry : fs::directory_iterator(data_dir)) {
+      const string file_name = entry.path().filename().string();
+      if (file_name.compare(0, prefix.size(), prefix) != 0) continue;
+
+      // read the header of this file
+      bool same_patterns = false;
+      bool two_sided_file = false;
+      string file_window;
+      double file_temp = 0;
+      double file_sample_error = 1;
+      ifstream input(entry.path().string());
+      string line;
+      while (getline(input, line) && !line.empty() && line[0] == '#') {
+        stringstream line_stream(line);
+        string key, value;
+        line_stream >> key >> key >> value;
+        if (key == "pattern_hash:") same_patterns = (value == to_string(pattern_hash));
+        if (key == "input_temp:") file_temp = stod(value);
+        if (key == "target_sample_error:") file_sample_error = stod(value);
+        if (key == "two_sided:") two_sided_file = (stoi(value) != 0);
+        if (key == "energy_window:") {
+          file_window = value;
+          line_stream >> value;
+          file_window += " " + value;
+        }
+      }
+      input.close();
+
+      // weights only cover the energy window of the simulation which computed them
+      if (file_window != window_tag) continue;
+      if (!same_patterns || (two_sided && !two_sided_file)) continue;
+      if (!two_sided_file && file_temp * input_temp <= 0) continue;
+      if (abs(file_temp) > abs(input_temp)) continue;
+      if (file_sample_error > target_sample_error) continue;
+      if (abs(file_temp) > abs(best_temp)) {
+        best_file = entry.path().string();
+        best_temp = file_temp;
+      }
+    }
+    return best_file;
+  };
 
   // simulation temperature in the same units as those used for our energies
   const double temp = input_temp * ns.network.nodes / ns.network.energy_scale;
@@ -286,11 +792,16 @@ int main(const int arg_num, const char *arg_vec[]) {
        << "pattern number: " << ns.pattern_number << endl
        << "temperature: " << input_temp << endl
        << "energy scale: " << ns.network.energy_scale << endl
-       << "maximum energy: " << ns.network.max_energy << endl
+       << "energy bounds: " << ns.network.min_energy << " to " << ns.network.max_energy
+       << endl
        << "maximum energy change: " << ns.network.max_energy_change << endl;
   if (!fixed_temp) {
     cout << "target sample error: " << target_sample_error << endl;
   }
+  if (use_energy_window) {
+    cout << "energy window: " << ns.actual_energy(0) << " to "
+         << ns.actual_energy(ns.energy_range - 1) << endl;
+  }
   cout << endl;
 
   if (!suppress) {
@@ -300,6 +811,391 @@ int main(const int arg_num, const char *arg_vec[]) {
     cout << endl;
   }
 
+  // print the total run time, which is the last thing we do in any simulation
+  auto print_total_run_time = [&]() {
+    const int total_time = difftime(time(NULL), simulation_start_time);
+    cout << "total run time: " << time_string(total_time) << endl;
+  };
+
+  // run a fixed-temperature simulation of several replicas, networks or temperatures,
+  //   given a function which makes a number of moves (recording data) and returns the
+  //   number of moves recorded so far, and a function which writes data files (which
+  //   are final, and may therefore include more data, if its argument is true)
+  // we run in chunks of one initialization cycle, so that we can periodically
+  //   write data files
+  auto run_simulation = [&](const function<long(const long)>& run_moves,
+                            const function<void(const bool)>& write_data) {
+    cout << endl << "starting simulation" << endl << endl;
+    clock_t last_data_print_time = time(NULL);
+    const long simulation_moves = ns.network.nodes * pow(10,log10_iterations);
+    for (long ii = 0; ii < simulation_moves; ii += moves_per_init_cycle) {
+      const long records = run_moves(min(moves_per_init_cycle, simulation_moves - ii));
+
+      // if enough time has passed, write data files
+      if ( difftime(time(NULL), last_data_print_time) > print_time * 60 ) {
+        cout << "moves: " << records << endl;
+        write_data(false);
+        last_data_print_time = time(NULL);
+      }
+    }
+
+    // write final data files
+    cout << "simulation complete" << endl;
+    write_data(true);
+  };
+
+  // -------------------------------------------------------------------------------------
+  // Multi-spin coded simulation of many replicas
+  // -------------------------------------------------------------------------------------
+
+  if (replicas > 1) {
+
+    // data files for individual replicas go in their own directory
+    const fs::path replica_dir = fs::path(data_dir) / fs::path("replicas");
+    fs::create_directory(replica_dir);
+
+    // write data files for the merged data of all replicas, and (if requested)
+    //   data files for every individual replica
+    auto write_replica_data = [&](const multispin_simulation& ms, const string header,
+                                  const bool individual_replicas) {
+      if (individual_replicas) {
+        for (int rr = 0; rr < replicas; rr++) {
+          const string replica_suffix
+            = file_suffix.substr(0, file_suffix.size() - 4) + "-r" + to_string(rr) + ".txt";
+          ms.export_replica(rr, ns);
+          ns.write_energy_file((replica_dir / ("energies" + replica_suffix)).string(),
+                               header);
+          ns.write_distance_file((replica_dir / ("distances" + replica_suffix)).string(),
+                                 header);
+          ns.write_state_file((replica_dir / ("states" + replica_suffix)).string(),
+                              header);
+        }
+      }
+      ms.export_replicas(ns);
+      ns.write_energy_file(energy_file, header);
+      ns.write_distance_file(distance_file, header);
+      ns.write_state_file(state_file, header);
+    };
+
+    cout << "starting a fixed temperature initialization routine for "
+         << replicas << " replicas" << endl;
+    multispin_simulation ms(ns, replicas, rnd, generator);
+    ms.run(moves_per_init_cycle, temp, false, rnd, generator);
+
+    run_simulation([&](const long moves) -> long {
+        ms.run(moves, temp, true, rnd, generator);
+        return ms.records;
+      }, [&](const bool final) {
+        write_replica_data(ms, file_header + "# moves: " + to_string(ms.records) + "\n",
+                           final);
+      });
+
+    // print possibly helpful console text
+    if (!suppress) {
+      ns.print_distances();
+      cout << endl;
+      ns.print_states();
+      cout << endl;
+    }
+
+    // print total runtime and exit
+    print_total_run_time();
+    return 0;
+  }
+
+  // -------------------------------------------------------------------------------------
+  // Simulation of many independent tiny networks
+  // -------------------------------------------------------------------------------------
+
+  if (networks > 1) {
+
+    // per-network data goes in its own file
+    const string network_file
+      = (fs::path(data_dir) / fs::path("networks" + file_suffix)).string();
+
+    // the first network starts in the initial state of our network simulation object,
+    //   and the rest start in new random states
+    vector<vector<bool>> initial_states = { ns.state };
+    for (int nn = 1; nn < networks; nn++) {
+      initial_states.push_back(random_state(nodes, rnd, generator));
+    }
+
+    cout << "starting a fixed temperature initialization routine for "
+         << networks << " networks" << endl;
+    tiny_network_batch batch(network_patterns, initial_states);
+    batch.run(moves_per_init_cycle, input_temp, false, rnd, generator);
+
+    run_simulation([&](const long moves) -> long {
+        batch.run(moves, input_temp, true, rnd, generator);
+        return batch.records;
+      }, [&](const bool final) {
+        const string header = file_header + "# moves: " + to_string(batch.records) + "\n";
+        batch.write_energy_file(energy_file, header);
+        batch.write_distance_file(distance_file, header);
+        if (final) batch.write_network_file(network_file, header);
+      });
+
+    // print total runtime and exit
+    print_total_run_time();
+    return 0;
+  }
+
+  // -------------------------------------------------------------------------------------
+  // Parallel tempering
+  // -------------------------------------------------------------------------------------
+
+  if (!temp_ladder.empty()) {
+
+    // write data files for every temperature
+    auto write_tempering_data = [&](const parallel_tempering& pt, const bool final) {
+      for (int tt = 0, size = temp_ladder.size(); tt < size; tt++) {
+        const string suffix = temp_suffix(temp_ladder[tt]);
+        const string header = (temp_file_header(temp_ladder[tt]) + "# moves: "
+                               + to_string(pt.replicas[tt].records) + "\n");
+        pt.export_replica(tt, ns);
+        ns.write_energy_file((fs::path(data_dir) / ("energies" + suffix)).string(),
+                             header);
+        ns.write_distance_file((fs::path(data_dir) / ("distances" + suffix)).string(),
+                               header);
+        if (final) {
+          ns.write_state_file((fs::path(data_dir) / ("states" + suffix)).string(),
+                              header);
+        }
+      }
+    };
+
+    cout << "starting a fixed temperature initialization routine for "
+         << temp_ladder.size() << " temperatures" << endl;
+    parallel_tempering pt(ns, temp_ladder, seed);
+
+    // if requested, tune the temperature ladder, keeping track of the ladder which
+    //   yields the most round trips per CPU-second
+    if (tune_ladder > 0) {
+      cout << "tuning temperature ladder" << endl
+           << "iteration, round trips, round trips per CPU-second, ladder" << endl;
+      vector<double> best_ladder = pt.input_temps;
+      double best_round_trip_rate = -1;
+      for (int ii = 0; ii < tune_ladder; ii++) {
+        pt.reset_flow();
+        const clock_t start_time = clock();
+        pt.run(moves_per_init_cycle, swap_interval, false, rnd, generator);
+        const double cpu_time = max(double(clock() - start_time) / CLOCKS_PER_SEC, 1e-9);
+        const double round_trip_rate = pt.round_trips / cpu_time;
+
+        cout << ii << " " << pt.round_trips << " " << round_trip_rate;
+        for (const double ladder_temp : pt.input_temps) {
+          cout << " " << ladder_temp;
+        }
+        cout << endl;
+
+        if (round_trip_rate > best_round_trip_rate) {
+          best_round_trip_rate = round_trip_rate;
+          best_ladder = pt.input_temps;
+        }
+        pt.set_input_temps(pt.feedback_input_temps());
+      }
+
+      // write the best ladder to a file and exit
+      ofstream ladder_stream(ladder_file);
+      ladder_stream << "# nodes: " << ns.network.nodes << endl
+                    << "# patterns: " << ns.pattern_number << endl
+                    << "# swap_interval: " << swap_interval << endl
+                    << "# round trips per CPU-second: " << best_round_trip_rate << endl
+                    << "# temperature" << endl
+                    << setprecision(numeric_limits<double>::max_digits10);
+      for (const double ladder_temp : best_ladder) {
+        ladder_stream << ladder_temp << endl;
+      }
+      ladder_stream.close();
+      cout << endl << "tuned temperature ladder written to:" << endl
+           << ladder_file << endl;
+
+      print_total_run_time();
+      return 0;
+    }
+
+    pt.run(moves_per_init_cycle, swap_interval, false, rnd, generator);
+    pt.reset_flow();
+
+    run_simulation([&](const long moves) -> long {
+        pt.run(moves, swap_interval, true, rnd, generator);
+        return pt.replicas[0].records;
+      }, [&](const bool final) {
+        write_tempering_data(pt, final);
+      });
+
+    cout << endl;
+    pt.print_swap_rates();
+    cout << "round trips: " << pt.round_trips << endl << endl;
+
+    // print total runtime and exit
+    print_total_run_time();
+    return 0;
+  }
+
+  // -------------------------------------------------------------------------------------
+  // Hamiltonian replica exchange
+  // -------------------------------------------------------------------------------------
+
+  if (!lambda_ladder.empty()) {
+
+    // write data files for the full network
+    auto write_exchange_data = [&](const parallel_tempering& he, const bool final) {
+      const string header = (file_header + "# moves: "
+                             + to_string(he.replicas[0].records) + "\n");
+      he.export_replica(0, ns);
+      ns.write_energy_file(energy_file, header);
+      ns.write_distance_file(distance_file, header);
+      if (final) ns.write_state_file(state_file, header);
+    };
+
+    cout << "starting a fixed temperature initialization routine for "
+         << lambda_ladder.size() << " hamiltonians" << endl;
+    parallel_tempering he(ns, vector<double>(lambda_ladder.size(), input_temp), seed,
+                          lambda_ladder);
+    he.run(moves_per_init_cycle, swap_interval, false, rnd, generator);
+
+    run_simulation([&](const long moves) -> long {
+        he.run(moves, swap_interval, true, rnd, generator);
+        return he.replicas[0].records;
+      }, [&](const bool final) {
+        write_exchange_data(he, final);
+      });
+
+    cout << endl;
+    he.print_swap_rates();
+    cout << endl;
+
+    // print possibly helpful console text
+    if (!suppress) {
+      ns.print_distances();
+      cout << endl;
+      ns.print_states();
+      cout << endl;
+    }
+
+    // print total runtime and exit
+    print_total_run_time();
+    return 0;
+  }
+
+  // -------------------------------------------------------------------------------------
+  // Population annealing
+  // -------------------------------------------------------------------------------------
+
+  if (population > 0) {
+
+    const string population_file
+      = (fs::path(data_dir) / fs::path("population" + file_suffix)).string();
+    const string dos_file
+      = (fs::path(data_dir) / fs::path("dos" + file_suffix)).string();
+
+    const int threads = max(int(thread::hardware_concurrency()), 1);
+    cout << "starting population annealing with " << population << " replicas in "
+         << threads << " threads" << endl
+         << "input_temp, population, mean energy" << endl;
+    population_annealing pa(ns, population, anneal_sweeps, anneal_steps, input_temp,
+                            threads, seed);
+    for (int kk = 0; kk <= anneal_steps; kk++) {
+      pa.run_step(kk, rnd, generator);
+      if (kk % max(anneal_steps / 10, 1) == 0 || kk == anneal_steps) {
+        cout << (kk > 0 ? 1 / pa.input_betas[kk] : numeric_limits<double>::infinity())
+             << " " << pa.populations[kk] << " "
+             << pa.energy_logs[kk] / pa.populations[kk] << endl;
+      }
+    }
+
+    cout << "population annealing complete" << endl;
+    pa.write_population_file(population_file, file_header);
+    pa.write_dos_file(dos_file, file_header);
+
+    // print total runtime and exit
+    print_total_run_time();
+    return 0;
+  }
+
+  // -------------------------------------------------------------------------------------
+  // Pattern sweep
+  // -------------------------------------------------------------------------------------
+
+  if (pattern_sweep) {
+
+    cout << "starting a pattern sweep" << endl
+         << "patterns, energy bounds, initialization cycles, sample_error,"
+         << " initialization time" << endl;
+
+    // we add the patterns to one network one at a time, and keep the simulation of
+    //   the last network in order to seed the density of states of the next one
+    hopfield_network sweep_network({ patterns[0] });
+    vector<network_simulation> last_simulation;
+    vector<bool> sweep_state = ns.state;
+    for (int pp = 1; pp <= pattern_number; pp++) {
+      const clock_t sweep_start_time = time(NULL);
+      if (pp > 1) sweep_network.add_pattern(patterns[pp-1]);
+      network_simulation sweep_ns(sweep_network, sweep_state, false);
+      const double sweep_temp = input_temp * nodes / sweep_network.energy_scale;
+      const long sweep_cycle_moves = nodes * pp * pow(10, init_factor);
+
+      // identify the weights of this network by its patterns
+      const string sweep_weights_file
+        = (fs::path(data_dir)
+           / fs::path("weights" + network_suffix(pp, input_temp,
+                                                 simulation_hash(sweep_network.patterns))))
+        .string();
+      const string sweep_header = network_file_header(sweep_ns, input_temp);
+
+      // as in any other simulation, we skip networks for which we already have weights
+      //   (or can reuse those of another temperature), unless we are asked to rebuild
+      //   them; the next network then starts from the last one we did initialize
+      const string reusable_weights_file
+        = ((reuse_weights && !rebuild_weights && !fs::exists(sweep_weights_file)) ?
+           find_reusable_weights(sweep_ns) : "");
+      if (!reusable_weights_file.empty()) {
+        sweep_ns.read_weights_file(reusable_weights_file);
+        sweep_ns.write_weights_file(sweep_weights_file, sweep_header);
+      }
+      if (!rebuild_weights && fs::exists(sweep_weights_file)) {
+        cout << pp << " " << sweep_network.min_energy << " " << sweep_network.max_energy
+             << " (weights found)" << endl;
+        continue;
+      }
+
+      if (!last_simulation.empty()) {
+        sweep_ns.estimate_dos_from_simulation(last_simulation[0]);
+      } else if (mean_field_seed) {
+        sweep_ns.estimate_dos_from_couplings();
+      }
+
+      // run the standard initialization routine
+      int cycles = 0;
+      double sample_error;
+      do {
+        sweep_ns.init_cycle(sweep_cycle_moves, sweep_temp, rnd, generator);
+        cycles++;
+        sweep_ns.compute_dos_from_transitions();
+        sample_error = sweep_ns.fractional_sample_error(sweep_temp);
+      } while (sample_error > target_sample_error);
+      if (dos_solver == "global") compute_dos_from_transitions_globally(sweep_ns);
+
+      // write the weights of this network
+      sweep_ns.compute_weights_from_dos(sweep_temp);
+      sweep_ns.write_weights_file(sweep_weights_file, sweep_header);
+
+      cout << pp << " " << sweep_network.min_energy << " " << sweep_network.max_energy
+           << " " << cycles << " " << sample_error << " "
+           << time_string(difftime(time(NULL), sweep_start_time)) << endl;
+
+      // carry the state and density of states of this network over to the next one
+      sweep_state = sweep_ns.state;
+      last_simulation.clear();
+      last_simulation.push_back(sweep_ns);
+    }
+
+    // print total runtime and exit
+    print_total_run_time();
+    return 0;
+  }
+
   // -------------------------------------------------------------------------------------
   // Initialization
   // -------------------------------------------------------------------------------------
@@ -315,13 +1211,16 @@ int main(const int arg_num, const char *arg_vec[]) {
     assert(current_energy < ns.energy_range);
     for (long ii = 0; ii < moves_per_init_cycle; ii++) {
 
-      // pick a random node to possibly flip,
-      //   and compute the change in energy from flipping it
+      // pick a random node to possibly flip, and draw the random number we will use
+      //   to decide whether to accept the move before computing its energy change,
+      //   which lets us stop reading couplings once the move is a certain rejection
       const int node = floor(rnd(generator) * ns.network.nodes);
-      const int energy_change = ns.node_flip_energy_change(node);
+      const double acceptance_draw = rnd(generator);
+      int energy_change;
 
       // if we pass a probability test, accept this move (i.e. node flip)
-      if (rnd(generator) < ns.move_probability(current_energy, energy_change, temp)) {
+      if (ns.node_flip_energy_change(node, temp, acceptance_draw, energy_change) &&
+          acceptance_draw < ns.move_probability(current_energy, energy_change, temp)) {
         ns.state[node] = !ns.state[node];
         current_energy += energy_change;
       }
@@ -331,138 +1230,339 @@ int main(const int arg_num, const char *arg_vec[]) {
 
   } else { // if we are not running a fixed-temperature simulation
     // initialize weight array for an all temperature simulation
+    ns.two_sided = two_sided;
+
+    // walk into the energy window (if we have one), giving up after the number of moves
+    //   in a few initialization cycles
+    if (!ns.enter_window(10 * moves_per_init_cycle, temp, rnd, generator)) {
+      cout << "failed to reach the energy window" << endl;
+      return -1;
+    }
+
+    // number of moves in the next initialization cycle, given the total number of moves
+    //   and the sample error after the last cycle, and the length of the last cycle
+    // if we adapt the cycle length, we estimate the exponent d with which the sample
+    //   error decays (as error ~ moves^-d) since we had made half as many moves, and
+    //   extrapolate the total number of moves we need to reach the target sample error
+    // the next cycle then covers half of the remaining moves, so that we overshoot the
+    //   target by at most half of our last cycle (if our extrapolation is good),
+    //   but it is never shorter than the default cycle length,
+    //   nor more than twice as long as the last cycle
+    vector<long> moves_log;
+    vector<double> error_log;
+    auto next_cycle_moves = [&](const long total_moves, const double sample_error,
+                                const long cycle_moves) -> long {
+      moves_log.push_back(total_moves);
+      error_log.push_back(sample_error);
+      if (!adaptive_cycles) return moves_per_init_cycle;
+
+      // we have no real statistics until the sample error falls below 1
+      if (sample_error >= 1) return cycle_moves;
+      int kk = 0;
+      while (moves_log[kk] < total_moves / 2 || error_log[kk] >= 1) kk++;
+      if (moves_log[kk] == total_moves) return cycle_moves;
+
+      const double decay = (log(error_log[kk] / sample_error)
+                            / log(double(total_moves) / moves_log[kk]));
+      if (decay <= 0) {
+        cout << "cycle length: " << cycle_moves << " moves"
+             << " (no decay in sample error since " << moves_log[kk] << " moves)"
+             << endl;
+        return cycle_moves;
+      }
+      const double predicted_moves
+        = total_moves * pow(sample_error / target_sample_error, 1 / decay);
+      const long next_moves
+        = min(max(long((predicted_moves - total_moves) / 2), moves_per_init_cycle),
+              2 * cycle_moves);
+      if (next_moves != cycle_moves) {
+        cout << "cycle length: " << next_moves << " moves"
+             << " (error decay exponent: " << defaultfloat << setprecision(3) << decay
+             << ", predicted total moves: " << long(predicted_moves) << ")" << endl;
+      }
+      return next_moves;
+    };
+
+    // compute the density of states from transition matrix data after a cycle
+    // the global solver is much more expensive than a sweep, and the sample error which
+    //   decides when we are done barely depends on the solver, so we only use the
+    //   global solver for the final density of states
+    auto compute_dos = [&](network_simulation& ns) {
+      if (ns.bin_width > 1) ns.compute_dos_from_bin_transitions();
+      else ns.compute_dos_from_transitions();
+    };
+
+    const string reusable_weights_file
+      = ((reuse_weights && !rebuild_weights && !fs::exists(weights_file)) ?
+         find_reusable_weights(ns) : "");
 
     // unless find a file which contains the weights we need for this simulation,
     //   run the standard initialization routine
-    if (!fs::exists(weights_file)) {
+    if (!reusable_weights_file.empty()) {
+
+      // read in the weights of an earlier simulation, and save them as our own
+      cout << "reusing weights from " << reusable_weights_file << endl;
+      ns.read_weights_file(reusable_weights_file);
+      ns.write_weights_file(weights_file, file_header);
 
-      cout << "starting all-temperature initialization routine..." << endl
-           << "moves per initialization cycle: " << moves_per_init_cycle << endl;
+    } else if (rebuild_weights || !fs::exists(weights_file)) {
+      if (mean_field_seed) {
+        ns.estimate_dos_from_couplings();
+        cout << "estimated entropy peak: " << ns.actual_energy(ns.entropy_peak)
+             << endl;
+      }
 
-      // if we find a file with a transition matrix for this simulation, read it in!
-      // even if this file was generated by an unfinished initialization process,
-      //   if the simulation hash is the same -- the data is perfectly good
-      if (fs::exists(transitions_file)) {
-        ns.read_transitions_file(transitions_file);
+      // if we search for the ground state, start initialization from the best state
+      //   we find (if it lies in our energy window), and make sure to sample its energy
+      bool ground_state_seeded = false;
+      if (ground_state_restarts > 0) {
+        const int search_threads = max(int(thread::hardware_concurrency()), 1);
+        const clock_t search_start_time = time(NULL);
+        const ground_state_search search(ns.network, ground_state_restarts,
+                                         search_threads, seed);
+        cout << "lowest energy found in ground state search: " << search.best_energy
+             << " (search time: "
+             << time_string(difftime(time(NULL), search_start_time)) << ")" << endl;
+        if (ns.in_window(ns.energy(search.best_state))) {
+          ns.state = search.best_state;
+          ns.known_ground_energy = ns.energy();
+          ground_state_seeded = true;
+        }
       }
 
-      cout << "sample_error cycle_number" << endl;
+      if (init_method == "rewl") {
+        // sample the density of states with replica-exchange wang-landau sampling
+        // we first run a few cycles of the standard initialization routine,
+        //   which gives us the entropy peak and the range of energies to sample
 
-      // number of initialization cycles we have completed
-      int cycles = 0;
-      // expected fractional error in sample count at the simulation temperature
-      double sample_error;
+        cout << "starting replica-exchange wang-landau initialization routine..." << endl
+             << "running " << rewl_preliminary_cycles << " preliminary cycles of "
+             << moves_per_init_cycle << " moves" << endl;
+        for (int cc = 0; cc < rewl_preliminary_cycles; cc++) {
+          ns.init_cycle(moves_per_init_cycle, temp, rnd, generator);
+        }
+        compute_dos(ns);
+
+        // the lowest and highest energies we have seen
+        int lowest_seen_energy = ns.energy_range - 1;
+        int highest_seen_energy = 0;
+        for (int ee = 0; ee < ns.energy_range; ee++) {
+          if (ns.energy_histogram[ee] == 0) continue;
+          lowest_seen_energy = min(ee, lowest_seen_energy);
+          highest_seen_energy = max(ee, highest_seen_energy);
+        }
 
-      int new_energy; // energy of the new state after every move
-      int old_energy = ns.energy(); // energy of the network state before the last move
-      assert(old_energy < ns.energy_range);
-      do { // while (sample_error > target_sample_error)
-        // run for one initialization cycle
-        for (long ii = 0; ii < moves_per_init_cycle; ii++) {
-
-          // pick a random node to possibly flip,
-          //   and compute the change in energy from flipping it
-          const int node = floor(rnd(generator) * ns.network.nodes);
-          const int energy_change = ns.node_flip_energy_change(node);
-          const int proposed_energy = old_energy + energy_change;
-          assert(abs(energy_change) <= ns.max_de);
-
-          // the transition histogram contains information about proposed moves, not
-          //   accepted moves, so we sample it always (even if the move is later rejected)
-          ns.update_transition_histogram(old_energy, energy_change);
-
-          if ((temp > 0 && energy_change <= 0) || (temp < 0 && energy_change >= 0)) {
-            // always accept moves to a lower (higher) energy in a positive (negative)
-            //   temperature simulation
-            ns.state[node] = !ns.state[node];
-            new_energy = proposed_energy;
-
-          } else { // accept the moves with some to-be-determined probability
-
-            // in order to get good statistics on the transition matrix,
-            //   we wish to sample all energies as equally as we can
-            // if the forward flux F_{i->f} of proposed moves from E_i to E_f is,
-            //   say, twice the backwards flux F_{f->i}, then to sample E_i and E_f
-            //   equally we should reject half of the proposed moves from E_i to E_f
-            // in general, the move probability necessary to sample E_i and E_f equally
-            //   is F_{f->i} / F_{i->f} (see: detailed balance)
-            const double move_probability = [&]() -> double {
-              // compute the (unnormalized) flux of proposed moves forward and backward
-              //   between the current and proposed energies
-              const long backward_moves = ns.transitions(proposed_energy, -energy_change);
-              const long forward_moves = ns.transitions(old_energy, energy_change);
-
-              // if we have never made the backward transition f->i, accept this move
-              if (backward_moves == 0) return 1;
-
-              // compute normalization factor for both transition fluxes
-              const long backward_norm = ns.transitions_from(proposed_energy);
-              const long forward_norm = ns.transitions_from(old_energy);
-
-              // compute the flux ratio F_{f->i} / F_{i->f}
-              const double flux_ratio = (double(backward_moves * forward_norm)
-                                         / (forward_moves * backward_norm));
-
-              // enforce a minimum acceptance probability based on:
-              //  i) how many times we have tried to make the backward move f->i;
-              //     if we have barely ever tried to move f->i, we want to be more likely
-              //     to move into E_f to gather more statistics on transitions out of it
-              // ii) the ratio of boltzmann weights on E_i and E_f at the minimum
-              //     temperature of the simulation; otherwise, we would be wasting our
-              //     time oversampling E_i relative to E_f
-              const double sample_floor = 1.0/backward_moves;
-              const double boltzmann_floor = exp(-energy_change / temp);
-              const double min_probability = max(sample_floor, boltzmann_floor);
-
-              return max(flux_ratio, min_probability);
-            }();
-
-            // if we pass a probability test, accept this move (i.e. node flip)
-            if (rnd(generator) < move_probability) {
-              ns.state[node] = !ns.state[node];
-              new_energy = proposed_energy;
-            } else {
-              // otherwise reject it
-              new_energy = old_energy;
-            }
+        // we sample energies between the entropy peak and the lowest (highest) energy
+        //   we have seen in a positive (negative) temperature simulation, and keep
+        //   sampling until the error in ln_dos (~ sqrt(ln_f)) is about sample_error
+        const int lowest_energy = (temp > 0) ? lowest_seen_energy : ns.entropy_peak;
+        const int highest_energy = (temp > 0) ? ns.entropy_peak : highest_seen_energy;
+        replica_exchange_wang_landau rewl(ns, lowest_energy, highest_energy,
+                                          temp > 0, temp < 0, rewl_windows, seed,
+                                          pow(target_sample_error, 2), temp);
+        const int walker_number = max(rewl_walkers, rewl_windows);
+        rewl.allocate_walkers(walker_number);
+
+        // run the walkers in rounds, in between which we attempt exchanges
+        //   and reallocate walkers; print the status of all windows every time
+        //   any window completes a stage of sampling
+        const long moves_per_round = ns.network.nodes * ns.pattern_number;
+        int stages = 0;
+        while (!rewl.converged()) {
+          rewl.run(moves_per_round);
+          rewl.attempt_exchanges(rnd, generator);
+          rewl.allocate_walkers(walker_number);
+
+          int new_stages = 0;
+          for (const energy_window& window : rewl.windows) {
+            new_stages += window.stages;
           }
+          if (new_stages > stages && !suppress) {
+            rewl.print_status();
+            cout << endl;
+          }
+          stages = new_stages;
+        }
+        rewl.print_status();
+        cout << endl;
+
+        rewl.stitch(ns);
+
+      } else if (init_method == "wl1t") {
+        // sample the density of states with wang-landau sampling (using the 1/t schedule)
+        //   until we reach the target sample error
+        // we sample all energies during the first cycle in order to locate the entropy
+        //   peak, and then only sample energies on our side of the peak
+
+        cout << "starting wang-landau (1/t) initialization routine..." << endl
+             << "moves per initialization cycle: " << moves_per_init_cycle << endl
+             << "sample_error cycle_number ln_f" << endl;
+
+        wang_landau_1t wang_landau;
+        int cycles = 0;
+        long cycle_moves = moves_per_init_cycle;
+        double sample_error;
+        do {
+          wang_landau.run(ns, cycle_moves, temp, cycles > 0, rnd, generator);
+          cycles++;
+          sample_error = ns.fractional_sample_error(temp);
+
+          cout << fixed << setprecision(ceil(-log10(target_sample_error)) + 3)
+               << sample_error << " " << cycles << " "
+               << scientific << setprecision(3) << wang_landau.ln_f << endl;
+          cycle_moves = next_cycle_moves(wang_landau.moves, sample_error, cycle_moves);
+
+          // if enough time has passed, write the energy file
+          if ( difftime(time(NULL), last_data_print_time) > print_time * 60 ) {
+            const string header = (file_header +
+                                   "# initialization moves: " +
+                                   to_string(wang_landau.moves) + "\n");
+            ns.write_energy_file(energy_file, header);
+            last_data_print_time = time(NULL);
+          }
+        } while (sample_error > target_sample_error);
+        cout << defaultfloat;
+
+      } else if (init_method == "nested") {
+        // sample the density of states with nested sampling, lowering the energy
+        //   threshold until we have removed all live states
+        cout << "starting nested sampling initialization routine..." << endl
+             << "live states: " << nested_live_points << endl
+             << "iterations, energy threshold, ln(volume below threshold)" << endl;
+
+        nested_sampling nested(ns, nested_live_points,
+                               long(nested_walk_sweeps) * ns.network.nodes,
+                               init_walkers, seed);
+        while (!nested.done) {
+          nested.iterate(rnd, generator);
+          if (nested.iterations % 100 == 0 || nested.done) {
+            cout << nested.iterations << " "
+                 << ns.actual_energy(*max_element(nested.live_energies.begin(),
+                                                  nested.live_energies.end())) << " "
+                 << nested.ln_volume << endl;
+          }
+        }
+        nested.export_dos(ns);
 
-          assert(new_energy < ns.energy_range);
-
-          // update the energy and sample histograms
-          // we don't care about other histograms during initialization
-          ns.energy_histogram[new_energy]++;
-          ns.update_sample_histogram(new_energy, old_energy);
+      } else { // use the standard initialization routine
+        cout << "starting all-temperature initialization routine..." << endl
+             << "moves per initialization cycle: " << moves_per_init_cycle << endl;
 
-          // as we move on with our lives (and this loop) the new energy turns old
-          old_energy = new_energy;
+        // if we find a file with a transition matrix for this simulation, read it in!
+        // even if this file was generated by an unfinished initialization process,
+        //   if the simulation hash is the same -- the data is perfectly good
+        if (fs::exists(transitions_file)) {
+          ns.read_transitions_file(transitions_file);
         }
 
-        // increment the cycle count and compute the density of states
-        cycles++;
-        ns.compute_dos_from_transitions();
-
-        // compute the expected fractional sample error at the simulation temperature
-        sample_error = ns.fractional_sample_error(temp);
-
-        // print helpful console text:
-        //   the current fractional sample error
-        //   and the number of initialization cycles we have completed
-        cout << fixed << setprecision(ceil(-log10(target_sample_error)) + 3)
-             << sample_error << " " << cycles << endl;
-
-        // if enough time has passed, write energy and transition data files
-        if ( difftime(time(NULL), last_data_print_time) > print_time * 60 ) {
-          const string header = (file_header +
-                                 "# initialization moves: " +
-                                 to_string(cycles * moves_per_init_cycle) + "\n");
-          ns.write_energy_file(energy_file, header);
-          ns.write_transitions_file(transitions_file, header);
-          last_data_print_time = time(NULL);
+        // start with coarse energy bins, if we are asked to
+        ns.set_bin_width(coarse_bins);
+        if (coarse_bins > 1) cout << "energy bin width: " << coarse_bins << endl;
+
+        cout << "sample_error cycle_number" << endl;
+
+        // number of initialization cycles we have completed, the total number of moves
+        //   in these cycles, and the number of moves in the next cycle
+        int cycles = 0;
+        long init_moves = 0;
+        long cycle_moves = moves_per_init_cycle;
+        // expected fractional error in sample count at the simulation temperature
+        double sample_error;
+
+        // if we use several initialization walkers, each walker runs in its own thread
+        //   on its own copy of the simulation (i.e. shard) with its own random state,
+        //   and we merge the histograms of all shards at the end of every cycle
+        // the walkers split the moves of every cycle between them
+        // note: walkers are only seeded (and walked into the energy window) once, and
+        //   keep their states between cycles, so splitting a cycle does not change the
+        //   number of cycles we need; the merge and the density of states computed after
+        //   every cycle, however, are serial, so the speedup is well below init_walkers
+        vector<network_simulation> shards;
+        vector<uniform_real_distribution<double>> shard_rnds(init_walkers);
+        vector<mt19937_64> shard_generators;
+        for (int ww = 0; ww < init_walkers && init_walkers > 1; ww++) {
+          seed_seq walker_seed = { seed, long(ww) };
+          shard_generators.push_back(mt19937_64(walker_seed));
+          shards.push_back(ns);
+          if (ww == 0 && ground_state_seeded) continue;
+          shards[ww].state = random_state(nodes, shard_rnds[ww], shard_generators[ww]);
+          if (!shards[ww].enter_window(10 * moves_per_init_cycle, temp, shard_rnds[ww],
+                                       shard_generators[ww])) {
+            cout << "failed to reach the energy window" << endl;
+            return -1;
+          }
         }
+        do { // while (sample_error > target_sample_error)
+          // run for one initialization cycle
+          if (init_walkers == 1) {
+            ns.init_cycle(cycle_moves, temp, rnd, generator);
+          } else {
+            const long moves_per_walker = (cycle_moves + init_walkers - 1) / init_walkers;
+            vector<thread> threads;
+            for (int ww = 0; ww < init_walkers; ww++) {
+              threads.push_back(thread(&network_simulation::init_cycle, &shards[ww],
+                                       moves_per_walker, temp, ref(shard_rnds[ww]),
+                                       ref(shard_generators[ww])));
+            }
+            for (thread& walker_thread : threads) {
+              walker_thread.join();
+            }
+            ns.merge_init_shards(shards);
+          }
 
-        // repeat initialization cycles until we satisfy the initialization end condition
-      } while (sample_error > target_sample_error);
+          // increment the cycle count and compute the density of states
+          cycles++;
+          init_moves += cycle_moves;
+          compute_dos(ns);
+
+          // compute the expected fractional sample error at the simulation temperature
+          sample_error = ns.fractional_sample_error(temp);
+
+          // print helpful console text:
+          //   the current fractional sample error
+          //   and the number of initialization cycles we have completed
+          cout << fixed << setprecision(ceil(-log10(target_sample_error)) + 3)
+               << sample_error << " " << cycles << endl;
+
+          // whenever we reach the target sample error with coarse energy bins,
+          //   halve the bin width, seeding the density of states at the new bin width
+          //   with all transitions we have recorded so far
+          // the decay of the sample error at the new bin width has nothing to do with
+          //   that at the old one, so we also forget the history of sample errors
+          while (sample_error <= target_sample_error && ns.bin_width > 1) {
+            ns.set_bin_width(ns.bin_width / 2);
+            for (network_simulation& shard : shards) {
+              shard.set_bin_width(ns.bin_width);
+            }
+            compute_dos(ns);
+            sample_error = ns.fractional_sample_error(temp);
+            moves_log.clear();
+            error_log.clear();
+            cout << "energy bin width: " << ns.bin_width << endl
+                 << sample_error << " " << cycles << endl;
+          }
+
+          // walkers decide whether they have crossed the entropy peak using their own
+          //   copy of it, so bring them up to date with the density of states
+          for (network_simulation& shard : shards) {
+            shard.entropy_peak = ns.entropy_peak;
+          }
+          cycle_moves = next_cycle_moves(init_moves, sample_error, cycle_moves);
+
+          // if enough time has passed, write energy and transition data files
+          if ( difftime(time(NULL), last_data_print_time) > print_time * 60 ) {
+            const string header = (file_header +
+                                   "# initialization moves: " +
+                                   to_string(init_moves) + "\n");
+            ns.write_energy_file(energy_file, header);
+            ns.write_transitions_file(transitions_file, header);
+            last_data_print_time = time(NULL);
+          }
+
+          // repeat initialization cycles until we satisfy the initialization end condition
+        } while (sample_error > target_sample_error);
+        if (dos_solver == "global") compute_dos_from_transitions_globally(ns);
+      }
 
       // once we have initialized, compute the weight array and write it to a file
       ns.compute_weights_from_dos(temp);
@@ -482,6 +1582,10 @@ int main(const int arg_num, const char *arg_vec[]) {
     // initialize a new random state and clear the data histograms
     generator.seed(seed+1);
     ns.state = random_state(nodes, rnd, generator);
+    if (!ns.enter_window(10 * moves_per_init_cycle, temp, rnd, generator)) {
+      cout << "failed to reach the energy window" << endl;
+      return -1;
+    }
     ns.initialize_histograms();
 
     const int init_time = difftime(time(NULL), simulation_start_time);
@@ -503,20 +1607,67 @@ int main(const int arg_num, const char *arg_vec[]) {
   int current_energy = ns.energy(); // energy of the last state
   assert(current_energy < ns.energy_range);
   long simulation_moves = ns.network.nodes * pow(10,log10_iterations);
+
+  // number of pattern moves we proposed and accepted
+  long pattern_moves = 0;
+  long accepted_pattern_moves = 0;
+
+  // if we measure autocorrelation times, record the energy and the overlaps with all
+  //   patterns after every sweep (i.e. every [nodes] moves)
+  vector<double> energy_series;
+  vector<vector<double>> overlap_series(ns.pattern_number);
+  const clock_t simulation_cpu_start = clock();
+
   for (long ii = 0; ii < simulation_moves; ii++) {
 
-    // pick a random node to possibly flip,
-    //   and compute the change in energy from flipping it
-    const int node = floor(rnd(generator) * ns.network.nodes);
-    const int energy_change = ns.node_flip_energy_change(node);
+    // with probability pattern_move_ratio, make a pattern-directed move
+    // note: we only draw this random number if we make pattern moves at all,
+    //   so that simulations without them are unchanged
+    if (pattern_move_ratio > 0 && rnd(generator) < pattern_move_ratio) {
+      vector<int> flips;
+      int energy_change;
+      double ln_proposal_ratio;
+      pattern_moves++;
+      new_energy = current_energy;
+      if (ns.propose_pattern_move(ns.state, rnd, generator,
+                                  flips, energy_change, ln_proposal_ratio) &&
+          ns.in_window(current_energy + energy_change) &&
+          rnd(generator) < (ns.move_probability(current_energy, energy_change, temp)
+                            * exp(ln_proposal_ratio))) {
+        for (const int node : flips) {
+          ns.state[node] = !ns.state[node];
+        }
+        new_energy = current_energy + energy_change;
+        accepted_pattern_moves++;
+      }
 
-    // if we pass a probability test, accept this move (i.e. node flip)
-    if (rnd(generator) < ns.move_probability(current_energy, energy_change, temp)) {
-      ns.state[node] = !ns.state[node];
-      new_energy = current_energy + energy_change;
     } else {
-      // otherwise reject it
-      new_energy = current_energy;
+      // pick a random node to possibly flip, and draw the random number we will use
+      //   to decide whether to accept the move
+      const int node = floor(rnd(generator) * ns.network.nodes);
+      const double acceptance_draw = rnd(generator);
+
+      // compute the change in energy from flipping the node; at a fixed temperature,
+      //   we can stop reading couplings as soon as the move is a certain rejection
+      int energy_change;
+      bool certain_rejection = false;
+      if (ns.fixed_temp) {
+        certain_rejection = !ns.node_flip_energy_change(node, temp, acceptance_draw,
+                                                        energy_change);
+      } else {
+        energy_change = ns.node_flip_energy_change(node);
+      }
+
+      // if we pass a probability test, accept this move (i.e. node flip)
+      // note: moves out of the energy window are always rejected
+      if (!certain_rejection && ns.in_window(current_energy + energy_change) &&
+          acceptance_draw < ns.move_probability(current_energy, energy_change, temp)) {
+        ns.state[node] = !ns.state[node];
+        new_energy = current_energy + energy_change;
+      } else {
+        // otherwise reject it
+        new_energy = current_energy;
+      }
     }
     assert(new_energy >= 0);
     assert(new_energy < ns.energy_range);
@@ -535,6 +1686,17 @@ int main(const int arg_num, const char *arg_vec[]) {
     // update the old energy
     current_energy = new_energy;
 
+    if (autocorrelation && (ii + 1) % ns.network.nodes == 0) {
+      energy_series.push_back(ns.actual_energy(current_energy));
+      for (int pp = 0; pp < ns.pattern_number; pp++) {
+        int overlap = 0;
+        for (int nn = 0; nn < ns.network.nodes; nn++) {
+          overlap += 2 * (ns.state[nn] == ns.patterns[pp][nn]) - 1;
+        }
+        overlap_series[pp].push_back(double(overlap) / ns.network.nodes);
+      }
+    }
+
     // if enough time has passed, write data files
     if ( difftime(time(NULL), last_data_print_time) > print_time * 60 ) {
       cout << "moves: " << ii << endl;
@@ -548,6 +1710,33 @@ int main(const int arg_num, const char *arg_vec[]) {
 
   // write final data files
   cout << "simulation complete" << endl;
+  if (pattern_moves > 0) {
+    cout << "pattern move acceptance rate: "
+         << double(accepted_pattern_moves) / pattern_moves << endl;
+  }
+
+  // report autocorrelation times in sweeps, and the number of independent samples
+  //   (i.e. autocorrelation times) we collected per CPU second
+  // for the pattern overlaps, we report the longest autocorrelation time of any pattern
+  if (autocorrelation) {
+    const double cpu_time
+      = max(double(clock() - simulation_cpu_start) / CLOCKS_PER_SEC, 1e-9);
+    const double sweeps = double(simulation_moves) / ns.network.nodes;
+    const double energy_tau = autocorrelation_time(energy_series);
+    double overlap_tau = 0;
+    for (int pp = 0; pp < ns.pattern_number; pp++) {
+      overlap_tau = max(overlap_tau, autocorrelation_time(overlap_series[pp]));
+    }
+    cout << "pattern move ratio: " << pattern_move_ratio << endl
+         << "simulation CPU time: " << cpu_time << " s" << endl
+         << "energy autocorrelation time: " << energy_tau << " sweeps"
+         << " (" << sweeps / max(energy_tau, 0.5) / cpu_time
+         << " independent samples per CPU second)" << endl
+         << "overlap autocorrelation time: " << overlap_tau << " sweeps"
+         << " (" << sweeps / max(overlap_tau, 0.5) / cpu_time
+         << " independent samples per CPU second)"
+         << endl;
+  }
   const string header = (file_header + "# moves: "
                          + to_string(simulation_moves) + "\n");
   ns.write_energy_file(energy_file, header);
@@ -571,8 +1760,7 @@ int main(const int arg_num, const char *arg_vec[]) {
   }
 
   // print total runtime and exit
-  const int total_time = difftime(time(NULL), simulation_start_time);
-  cout << "total run time: " << time_string(total_time) << endl;
+  print_total_run_time();
   return 0;
 
 }
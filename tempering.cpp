@@ -0,0 +1,343 @@
+#include <iostream> // for standard output
+#include <iomanip> // for io manipulation (e.g. setw)
+#include <random> // for randomness
+#include <cassert> // for assertions
+#include <algorithm> // for min and max
+#include <thread> // for multithreading
+#include <mutex> // for mutual exclusion locks
+#include <condition_variable> // for synchronizing threads
+
+#include "methods.h"
+#include "tempering.h"
+
+using namespace std;
+
+// ---------------------------------------------------------------------------------------
+// Tempering replica methods
+// ---------------------------------------------------------------------------------------
+
+tempering_replica::tempering_replica(const network_simulation& ns, const double temp,
+                                     const double lambda, const vector<bool>& state,
+                                     const mt19937_64& generator) :
+  temp(temp),
+  lambda(lambda),
+  state(state),
+  energy(ns.energy(state)),
+  generator(generator)
+{
+  const vector<bool>& last_pattern = ns.patterns[ns.pattern_number - 1];
+  overlap = 0;
+  for (int ii = 0; ii < ns.network.nodes; ii++) {
+    overlap += 2 * (state[ii] == last_pattern[ii]) - 1;
+  }
+  move_probabilities = vector<double>(2*ns.max_de + 1);
+  for (int de = -ns.max_de; de <= ns.max_de; de++) {
+    move_probabilities[de + ns.max_de] = exp(-de/temp);
+  }
+  energy_histogram = vector<long>(ns.energy_range, 0);
+  state_histograms = vector<long>(ns.network.nodes, 0);
+}
+
+// energy which this replica assigns to a state with a given energy index and overlap
+//   with the last pattern, up to a constant
+double tempering_replica::hamiltonian(const network_simulation& ns, const int energy,
+                                      const int overlap) const {
+  if (lambda == 1) return energy;
+  return energy - (1 - lambda) / ns.network.energy_scale * (-0.5 * overlap * overlap);
+}
+
+// run for a given number of moves, recording data from every move if record is true
+void tempering_replica::run(const network_simulation& ns, const long moves,
+                            const bool record) {
+  uniform_real_distribution<double> rnd;
+  const vector<bool>& last_pattern = ns.patterns[ns.pattern_number - 1];
+  for (long mm = 0; mm < moves; mm++) {
+
+    // pick a random node to possibly flip, and draw the random number we will use
+    //   to decide whether to accept the move
+    const int node = floor(rnd(generator) * ns.network.nodes);
+    const double acceptance_draw = rnd(generator);
+
+    // flipping the node changes the overlap with the last pattern by -2 x_i s_i
+    const int new_overlap = overlap - 2 * (2 * (state[node] == last_pattern[node]) - 1);
+
+    // if we pass a probability test, accept this move (i.e. node flip)
+    // with the full network, we can stop reading couplings as soon as the move is a
+    //   certain rejection, and look up the acceptance probability
+    int energy_change;
+    bool accept;
+    if (lambda == 1) {
+      accept = (ns.node_flip_energy_change(state, node, temp, acceptance_draw,
+                                           energy_change) &&
+                acceptance_draw < move_probabilities[energy_change + ns.max_de]);
+    } else {
+      energy_change = ns.node_flip_energy_change(state, node);
+      const double scaled_energy_change = (hamiltonian(ns, energy + energy_change,
+                                                       new_overlap)
+                                           - hamiltonian(ns, energy, overlap));
+      accept = (acceptance_draw < exp(-scaled_energy_change/temp));
+    }
+    if (accept) {
+      state[node] = !state[node];
+      energy += energy_change;
+      overlap = new_overlap;
+    }
+    assert(energy >= 0 && energy < ns.energy_range);
+
+    if (!record) continue;
+
+    // update histograms
+    energy_histogram[energy]++;
+    for (int ii = 0; ii < ns.network.nodes; ii++) {
+      state_histograms[ii] += state[ii];
+    }
+
+    // the distance log takes O(pattern_number) time to update,
+    //   so only upate it every [pattern_number] moves
+    if (records % ns.pattern_number == 0) {
+      int min_distance = ns.network.nodes;
+      for (int pp = 0; pp < ns.pattern_number; pp++) {
+        int overlap = 0;
+        for (int ii = 0; ii < ns.network.nodes; ii++) {
+          overlap += (state[ii] == ns.patterns[pp][ii]);
+        }
+        min_distance = min({min_distance, overlap, ns.network.nodes - overlap});
+      }
+      distance_log += min_distance;
+      distance_records++;
+    }
+
+    records++;
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Parallel tempering methods
+// ---------------------------------------------------------------------------------------
+
+parallel_tempering::parallel_tempering(const network_simulation& ns,
+                                       const vector<double>& input_temps,
+                                       const long seed, const vector<double>& lambdas) :
+  ns(ns),
+  input_temps(input_temps),
+  lambdas(lambdas.empty() ? vector<double>(input_temps.size(), 1) : lambdas)
+{
+  assert(input_temps.size() > 1 && this->lambdas.size() == input_temps.size());
+  const int replica_number = input_temps.size();
+  for (int tt = 0; tt < replica_number; tt++) {
+    seed_seq replica_seed = { seed, long(tt) };
+    mt19937_64 generator(replica_seed);
+    uniform_real_distribution<double> rnd;
+    const vector<bool> state
+      = (tt == 0) ? ns.state : random_state(ns.network.nodes, rnd, generator);
+    const double temp = input_temps[tt] * ns.network.nodes / ns.network.energy_scale;
+    replicas.push_back(tempering_replica(ns, temp, this->lambdas[tt], state, generator));
+  }
+  swap_attempts = vector<long>(replica_number - 1, 0);
+  swap_acceptances = vector<long>(replica_number - 1, 0);
+
+  walker_labels = vector<int>(replica_number);
+  for (int tt = 0; tt < replica_number; tt++) {
+    walker_labels[tt] = tt;
+  }
+  walker_directions = vector<direction>(replica_number, none);
+  flow_visits = vector<long>(replica_number, 0);
+  flow_up_visits = vector<long>(replica_number, 0);
+}
+
+// run every replica for a given number of moves, attempting to swap neighboring
+//   replicas every swap_interval moves, and recording data if record is true
+void parallel_tempering::run(const long moves, const long swap_interval,
+                             const bool record, uniform_real_distribution<double>& rnd,
+                             mt19937_64& generator) {
+  assert(swap_interval > 0);
+  const int replica_number = replicas.size();
+  const long intervals = (moves + swap_interval - 1) / swap_interval;
+
+  // every replica runs in its own thread for the entire run, and all threads meet at
+  //   the end of every interval of swap_interval moves; the last thread to finish an
+  //   interval attempts swaps (while holding the lock), and then releases the others
+  //   into the next interval
+  mutex interval_mutex;
+  condition_variable interval_end;
+  int running_replicas = replica_number;
+  long finished_intervals = 0;
+  auto run_replica = [&](const int tt) {
+    for (long ii = 0; ii < intervals; ii++) {
+      const long interval_moves = min(swap_interval, moves - ii * swap_interval);
+      replicas[tt].run(ns, interval_moves, record);
+
+      unique_lock<mutex> lock(interval_mutex);
+      if (--running_replicas > 0) {
+        interval_end.wait(lock, [&] { return finished_intervals > ii; });
+        continue;
+      }
+      if (interval_moves == swap_interval) {
+        attempt_swaps(rnd, generator);
+      }
+      running_replicas = replica_number;
+      finished_intervals++;
+      interval_end.notify_all();
+    }
+  };
+
+  vector<thread> threads;
+  for (int tt = 0; tt < replica_number; tt++) {
+    threads.push_back(thread(run_replica, tt));
+  }
+  for (thread& replica_thread : threads) {
+    replica_thread.join();
+  }
+
+  // make sure that we have kept track of energies correctly
+  for (const tempering_replica& replica : replicas) {
+    assert(replica.energy == ns.energy(replica.state));
+  }
+}
+
+// attempt to swap the states of neighboring replicas
+// a swap between replicas a and b at temperatures T_a and T_b, with hamiltonians H_a and
+//   H_b and states x and y, is accepted with probability min(1, exp(-D)), where
+//   D = (H_a(y) - H_a(x)) / T_a + (H_b(x) - H_b(y)) / T_b; with the full network on both
+//   replicas, this reduces to D = (1/T_a - 1/T_b) * (E_b - E_a)
+void parallel_tempering::attempt_swaps(uniform_real_distribution<double>& rnd,
+                                       mt19937_64& generator) {
+  for (int tt = swap_rounds % 2; tt + 1 < int(replicas.size()); tt += 2) {
+    tempering_replica& replica = replicas[tt];
+    tempering_replica& neighbor = replicas[tt+1];
+    double ln_ratio;
+    if (replica.lambda == 1 && neighbor.lambda == 1) {
+      ln_ratio = (1/replica.temp - 1/neighbor.temp) * (replica.energy - neighbor.energy);
+    } else {
+      ln_ratio = - ((replica.hamiltonian(ns, neighbor.energy, neighbor.overlap)
+                     - replica.hamiltonian(ns, replica.energy, replica.overlap))
+                    / replica.temp
+                    + (neighbor.hamiltonian(ns, replica.energy, replica.overlap)
+                       - neighbor.hamiltonian(ns, neighbor.energy, neighbor.overlap))
+                    / neighbor.temp);
+    }
+    swap_attempts[tt]++;
+    if (ln_ratio >= 0 || rnd(generator) < exp(ln_ratio)) {
+      swap(replica.state, neighbor.state);
+      swap(replica.energy, neighbor.energy);
+      swap(replica.overlap, neighbor.overlap);
+      swap(walker_labels[tt], walker_labels[tt+1]);
+      swap_acceptances[tt]++;
+    }
+  }
+  swap_rounds++;
+  update_flow();
+}
+
+// update walker directions and flow histograms after a round of swap attempts
+void parallel_tempering::update_flow() {
+  const int replica_number = replicas.size();
+  for (int tt = 0; tt < replica_number; tt++) {
+    const int walker = walker_labels[tt];
+    if (tt == 0) {
+      if (walker_directions[walker] == down) round_trips++;
+      walker_directions[walker] = up;
+    } else if (tt == replica_number - 1) {
+      walker_directions[walker] = down;
+    }
+    if (walker_directions[walker] != none) {
+      flow_visits[tt]++;
+      flow_up_visits[tt] += (walker_directions[walker] == up);
+    }
+  }
+}
+
+// reset flow histograms, round trip counts, and swap statistics
+void parallel_tempering::reset_flow() {
+  fill(flow_visits.begin(), flow_visits.end(), 0);
+  fill(flow_up_visits.begin(), flow_up_visits.end(), 0);
+  fill(swap_attempts.begin(), swap_attempts.end(), 0);
+  fill(swap_acceptances.begin(), swap_acceptances.end(), 0);
+  round_trips = 0;
+}
+
+// change the temperature ladder
+void parallel_tempering::set_input_temps(const vector<double>& new_input_temps) {
+  assert(new_input_temps.size() == replicas.size());
+  input_temps = new_input_temps;
+  for (int tt = 0, size = replicas.size(); tt < size; tt++) {
+    const double temp = input_temps[tt] * ns.network.nodes / ns.network.energy_scale;
+    replicas[tt].temp = temp;
+    for (int de = -ns.max_de; de <= ns.max_de; de++) {
+      replicas[tt].move_probabilities[de + ns.max_de] = exp(-de/temp);
+    }
+  }
+}
+
+// a temperature ladder which (approximately) maximizes the flow of walkers between the
+//   lowest and highest temperatures, computed from the fraction of walkers moving up
+//   at each temperature (i.e. the feedback method of Katzgraber et al.)
+// if f(T) is the fraction of walkers at temperature T which are moving up,
+//   the optimal density of temperatures is proportional to sqrt(-df/dT / dT);
+//   we take this density to be constant between neighboring temperatures,
+//   and place the new temperatures at equally spaced quantiles of the density
+// note: the lowest and highest temperatures in the ladder are kept fixed
+vector<double> parallel_tempering::feedback_input_temps() const {
+  const int replica_number = input_temps.size();
+
+  // fraction of walkers moving up at each temperature;
+  //   by construction, this fraction is 1 at the lowest temperature,
+  //   and 0 at the highest one
+  vector<double> up_fractions(replica_number);
+  for (int tt = 0; tt < replica_number; tt++) {
+    up_fractions[tt] = (flow_visits[tt] > 0 ?
+                        double(flow_up_visits[tt]) / flow_visits[tt] :
+                        1 - double(tt) / (replica_number - 1));
+  }
+
+  // (unnormalized) density of temperatures between each pair of neighbors
+  // we keep the fraction of walkers moving up from (spuriously) increasing with
+  //   temperature, which can happen due to noise, by putting a floor on its decrease
+  const double min_fraction_change = 1e-3 / replica_number;
+  vector<double> densities(replica_number - 1);
+  vector<double> cumulative_densities(replica_number, 0);
+  for (int tt = 0; tt < replica_number - 1; tt++) {
+    const double fraction_change
+      = max(up_fractions[tt] - up_fractions[tt+1], min_fraction_change);
+    const double temp_change = input_temps[tt+1] - input_temps[tt];
+    densities[tt] = sqrt(fraction_change) / temp_change;
+    cumulative_densities[tt+1] = cumulative_densities[tt] + densities[tt] * temp_change;
+  }
+
+  // place new temperatures at equally spaced quantiles of the density
+  vector<double> new_input_temps = input_temps;
+  int interval = 0;
+  for (int tt = 1; tt < replica_number - 1; tt++) {
+    const double target
+      = cumulative_densities.back() * double(tt) / (replica_number - 1);
+    while (cumulative_densities[interval+1] < target) interval++;
+    new_input_temps[tt] = (input_temps[interval]
+                           + (target - cumulative_densities[interval]) / densities[interval]);
+  }
+  return new_input_temps;
+}
+
+// copy the data recorded by one replica into a simulation object
+void parallel_tempering::export_replica(const int replica,
+                                        network_simulation& target) const {
+  target.energy_histogram = replicas[replica].energy_histogram;
+  target.fixed_temp_distance_records = replicas[replica].distance_records;
+  target.fixed_temp_distance_log = replicas[replica].distance_log;
+  target.state_records = replicas[replica].records;
+  target.state_histograms = replicas[replica].state_histograms;
+}
+
+// print swap acceptance rates between neighboring replicas, which we label by their
+//   temperatures, or by their lambdas if all replicas are at the same temperature
+void parallel_tempering::print_swap_rates() const {
+  const bool lambda_labels = (input_temps.front() == input_temps.back());
+  const vector<double>& labels = lambda_labels ? lambdas : input_temps;
+  cout << (lambda_labels ? "lambda" : "temperature")
+       << " pair, swap attempts, swap acceptance rate" << endl;
+  for (int tt = 0; tt + 1 < int(replicas.size()); tt++) {
+    cout << labels[tt] << " " << labels[tt+1] << " "
+         << swap_attempts[tt] << " "
+         << (swap_attempts[tt] > 0 ? double(swap_acceptances[tt]) / swap_attempts[tt] : 0)
+         << endl;
+  }
+}
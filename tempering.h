@@ -0,0 +1,145 @@
+#pragma once
+
+#include <random> // for randomness
+
+#include "methods.h"
+
+using namespace std;
+
+// one replica in a replica exchange simulation: a network state at a fixed temperature,
+//   evolving under a hamiltonian in which the contribution of the last pattern is scaled
+//   by lambda, together with all data recorded by this replica
+// in terms of the overlap m = \sum_i x_i s_i of a state with the last pattern, the
+//   (actual) energy contributed by this pattern is -1/2 (m^2 - N), so the energy of this
+//   replica is E - (1 - lambda) * (-1/2) (m^2 - N), where E is the energy of the network
+// note: states (and their energies) are exchanged between replicas, but the temperature,
+//   lambda, random number generator, and recorded data of a replica stay where they are
+struct tempering_replica {
+
+  // simulation temperature in the same units as those used for our energies
+  double temp;
+
+  // scale of the contribution of the last pattern to the energy
+  double lambda;
+
+  // current state, its energy (index) in the full network, and its overlap with the
+  //   last pattern
+  vector<bool> state;
+  int energy;
+  int overlap;
+
+  // random number generator used for moves of this replica
+  mt19937_64 generator;
+
+  // acceptance probabilities for all possible energy changes, indexed by de + max_de
+  vector<double> move_probabilities;
+
+  // number of moves for which we have recorded data, and histograms of the energies
+  //   and node states seen at this temperature
+  long records = 0;
+  vector<long> energy_histogram;
+  vector<long> state_histograms;
+
+  // number of times we have recorded distance from patterns,
+  //   and the sum of all recorded distances
+  long distance_records = 0;
+  long distance_log = 0;
+
+  tempering_replica(const network_simulation& ns, const double temp, const double lambda,
+                    const vector<bool>& state, const mt19937_64& generator);
+
+  // energy (in the same units as those used for our energies) which this replica
+  //   assigns to a state with a given energy index and overlap with the last pattern,
+  //   up to a constant
+  double hamiltonian(const network_simulation& ns, const int energy,
+                     const int overlap) const;
+
+  // run for a given number of moves, recording data from every move if record is true
+  // note: this method only reads from ns, so replicas can run in concurrent threads
+  void run(const network_simulation& ns, const long moves, const bool record);
+
+};
+
+// fixed-temperature simulation of several replicas of one network along a ladder of
+//   temperatures and/or scales of the last pattern (lambda), in which neighboring
+//   replicas periodically attempt to swap states
+// with lambda = 1 on every replica, this is parallel tempering; with one temperature,
+//   this is hamiltonian replica exchange between the network and one without its last
+//   pattern (networks with fewer patterns equilibrate faster at low temperatures, so
+//   states decorrelate by travelling down the ladder and back)
+// every replica runs in its own thread, pausing for swap attempts, and all replicas share
+//   the (read-only) network of one network simulation object
+struct parallel_tempering {
+
+  // simulation which provides the network, patterns, and energy range,
+  //   and into which we export replica data for writing data files
+  const network_simulation& ns;
+
+  // temperature ladder, in the units of the input temperature
+  vector<double> input_temps;
+
+  // ladder of scales of the contribution of the last pattern to the energy
+  const vector<double> lambdas;
+
+  vector<tempering_replica> replicas;
+
+  // to measure the flow of states through the temperature ladder, we label each state
+  //   by the "walker" which carries it from replica to replica, and give each walker a
+  //   direction: up if it has most recently visited the lowest temperature, down if
+  //   it has most recently visited the highest temperature, and none if neither
+  enum direction { none, up, down };
+  vector<int> walker_labels; // walker whose state is held by each replica
+  vector<direction> walker_directions; // indexed by walker
+
+  // number of times we have seen walkers with any direction, and with direction up,
+  //   at each temperature, as well as the number of completed round trips
+  //   (from the lowest to the highest temperature and back) made by any walker
+  vector<long> flow_visits;
+  vector<long> flow_up_visits;
+  long round_trips = 0;
+
+  // number of swap attempts and accepted swaps between replicas tt and tt+1,
+  //   indexed by tt
+  vector<long> swap_attempts;
+  vector<long> swap_acceptances;
+
+  // number of rounds of swap attempts so far; we alternate between attempting swaps
+  //   of (even, odd) and (odd, even) pairs of neighboring replicas
+  long swap_rounds = 0;
+
+  // constructor: the first replica starts in the state of the simulation ns, and all
+  //   other replicas start in random states
+  // the random number generator of replica tt is seeded by (seed, tt)
+  // if no lambdas are given, all replicas carry the full network (i.e. lambda = 1)
+  parallel_tempering(const network_simulation& ns, const vector<double>& input_temps,
+                     const long seed, const vector<double>& lambdas = {});
+
+  // run every replica for a given number of moves, attempting to swap neighboring
+  //   replicas every swap_interval moves, and recording data if record is true
+  void run(const long moves, const long swap_interval, const bool record,
+           uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // attempt to swap the states of neighboring replicas
+  void attempt_swaps(uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // update walker directions and flow histograms after a round of swap attempts
+  void update_flow();
+
+  // reset flow histograms, round trip counts, and swap statistics
+  void reset_flow();
+
+  // change the temperature ladder
+  void set_input_temps(const vector<double>& new_input_temps);
+
+  // a temperature ladder which (approximately) maximizes the flow of walkers between the
+  //   lowest and highest temperatures, computed from the fraction of walkers moving up
+  //   at each temperature (i.e. the feedback method of Katzgraber et al.)
+  vector<double> feedback_input_temps() const;
+
+  // copy the data recorded by one replica into a simulation object
+  void export_replica(const int replica, network_simulation& target) const;
+
+  // print swap acceptance rates between neighboring replicas
+  void print_swap_rates() const;
+
+};
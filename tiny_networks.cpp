@@ -0,0 +1,247 @@
+#include <iostream> // for standard output
+#include <iomanip> // for io manipulation (e.g. setprecision)
+#include <random> // for randomness
+#include <fstream> // for stream objects
+#include <cstdint> // for fixed-width integer types
+#include <cassert> // for assertions
+#include <algorithm> // for min and max
+
+#include "tiny_networks.h"
+
+using namespace std;
+
+// definitions of static constants, which are needed when they are passed by reference
+const int tiny_network_batch::max_nodes;
+const int tiny_network_batch::block_size;
+
+// tiny network batch constructor
+tiny_network_batch::tiny_network_batch(const vector<vector<vector<bool>>>& network_patterns,
+                                       const vector<vector<bool>>& initial_states) :
+  nodes(initial_states[0].size()),
+  pattern_number(network_patterns[0].size()),
+  networks(initial_states.size()),
+  min_energy(- pattern_number * nodes * (nodes - 1) / 2),
+  energy_range(pattern_number * nodes * nodes / 2 + 1)
+{
+  assert(nodes <= max_nodes);
+  assert(int(network_patterns.size()) == networks);
+
+  // pack patterns and states into machine words
+  patterns = vector<uint64_t>(pattern_number * networks, 0);
+  states = vector<uint64_t>(networks, 0);
+  for (int nn = 0; nn < networks; nn++) {
+    for (int ii = 0; ii < nodes; ii++) {
+      states[nn] |= uint64_t(initial_states[nn][ii]) << ii;
+      for (int pp = 0; pp < pattern_number; pp++) {
+        patterns[pp * networks + nn] |= uint64_t(network_patterns[nn][pp][ii]) << ii;
+      }
+    }
+  }
+
+  // compute overlaps and energies
+  overlaps = vector<int>(pattern_number * networks);
+  energies = vector<int>(networks, 0);
+  for (int pp = 0; pp < pattern_number; pp++) {
+    for (int nn = 0; nn < networks; nn++) {
+      const int mismatches = __builtin_popcountll(patterns[pp * networks + nn]
+                                                  ^ states[nn]);
+      const int overlap = nodes - 2 * mismatches;
+      overlaps[pp * networks + nn] = overlap;
+      energies[nn] -= (overlap * overlap - nodes) / 2;
+    }
+  }
+
+  // initialize histograms
+  energy_histogram = vector<long>(energy_range, 0);
+  energy_logs = vector<long>(networks, 0);
+  squared_energy_logs = vector<double>(networks, 0);
+  energy_since = vector<long>(networks, 0);
+  distance_logs = vector<long>(networks, 0);
+}
+
+// add the current energy of a network to histograms and logs once for every record
+//   since the network arrived at this energy, up to (but not including) a given record
+void tiny_network_batch::log_energy(const int network, const long record) {
+  const int energy = energies[network];
+  const long duration = record - energy_since[network];
+  assert(energy >= min_energy && energy < min_energy + energy_range);
+  energy_histogram[energy - min_energy] += duration;
+  energy_logs[network] += duration * energy;
+  squared_energy_logs[network] += double(duration) * energy * energy;
+  energy_since[network] = record;
+}
+
+// run for a given number of moves (per network) at a fixed temperature,
+//   recording data from every move if record is true
+void tiny_network_batch::run(const long moves, const double input_temp, const bool record,
+                             uniform_real_distribution<double>& rnd,
+                             mt19937_64& generator) {
+  // simulation temperature in the same units as those used for our energies
+  const double temp = input_temp * nodes;
+
+  // acceptance probabilities for all possible energy changes, as thresholds for
+  //   uniformly distributed 64-bit random numbers
+  const int max_de = 2 * pattern_number * nodes;
+  vector<uint64_t> move_thresholds(2*max_de + 1);
+  for (int de = -max_de; de <= max_de; de++) {
+    const double move_probability = exp(-de/temp);
+    move_thresholds[de + max_de] = (move_probability < 1 ?
+                                    uint64_t(ldexp(move_probability, 64)) :
+                                    numeric_limits<uint64_t>::max());
+  }
+
+  // start keeping track of how long networks have been at their current energies
+  if (record) {
+    for (int nn = 0; nn < networks; nn++) {
+      energy_since[nn] = records;
+    }
+  }
+
+  // per-network work arrays for a block of networks
+  int energy_changes[block_size];
+  int accepted[block_size];
+
+  for (int block_start = 0; block_start < networks; block_start += block_size) {
+    const int block = min(block_size, networks - block_start);
+    uint64_t* block_states = states.data() + block_start;
+    int* block_energies = energies.data() + block_start;
+
+    for (long mm = 0; mm < moves; mm++) {
+      const long record_index = records + mm; // index of the record for this move
+
+      // pick a random node to possibly flip in every network in this block
+      const int node = floor(rnd(generator) * nodes);
+
+      // compute the energy change from flipping the node in every network,
+      //   starting with the local field \sum_p x^p_i m_p on the node
+      for (int bb = 0; bb < block; bb++) {
+        energy_changes[bb] = 0;
+      }
+      for (int pp = 0; pp < pattern_number; pp++) {
+        const uint64_t* block_patterns = patterns.data() + pp * networks + block_start;
+        const int* block_overlaps = overlaps.data() + pp * networks + block_start;
+        for (int bb = 0; bb < block; bb++) {
+          const int pattern_sign = 2 * int((block_patterns[bb] >> node) & 1) - 1;
+          energy_changes[bb] += pattern_sign * block_overlaps[bb];
+        }
+      }
+      for (int bb = 0; bb < block; bb++) {
+        const int node_sign = 2 * int((block_states[bb] >> node) & 1) - 1;
+        energy_changes[bb] = 2 * node_sign * energy_changes[bb] - 2 * pattern_number;
+      }
+
+      // decide whether to accept the move in each network; we only need to draw
+      //   random numbers for moves which are not accepted with certainty
+      for (int bb = 0; bb < block; bb++) {
+        const int de = energy_changes[bb];
+        accepted[bb] = ((temp > 0 && de <= 0) || (temp < 0 && de >= 0) ||
+                        generator() < move_thresholds[de + max_de]);
+      }
+
+      // if we are recording data, then before changing the energies of networks,
+      //   bring the histograms for these networks up to date
+      if (record) {
+        for (int bb = 0; bb < block; bb++) {
+          if (!accepted[bb] || energy_changes[bb] == 0) continue;
+          log_energy(block_start + bb, record_index);
+        }
+      }
+
+      // update overlaps, states, and energies of the networks which accepted the move
+      // when node i flips from s_i to -s_i, the overlap m_p changes by -2 x^p_i s_i
+      for (int pp = 0; pp < pattern_number; pp++) {
+        const uint64_t* block_patterns = patterns.data() + pp * networks + block_start;
+        int* block_overlaps = overlaps.data() + pp * networks + block_start;
+        for (int bb = 0; bb < block; bb++) {
+          const int aligned = int(((block_patterns[bb] ^ ~block_states[bb]) >> node) & 1);
+          block_overlaps[bb] -= accepted[bb] * 2 * (2 * aligned - 1);
+        }
+      }
+      for (int bb = 0; bb < block; bb++) {
+        block_states[bb] ^= uint64_t(accepted[bb]) << node;
+        block_energies[bb] += accepted[bb] * energy_changes[bb];
+      }
+
+      if (!record) continue;
+
+      // the distance log takes O(pattern_number) time to update,
+      //   so only upate it every [pattern_number] moves
+      if (record_index % pattern_number == 0) {
+        for (int bb = 0; bb < block; bb++) {
+          int max_overlap = 0;
+          for (int pp = 0; pp < pattern_number; pp++) {
+            max_overlap = max(abs(overlaps[pp * networks + block_start + bb]),
+                              max_overlap);
+          }
+          // the distance from the nearest pattern (or its inverse)
+          distance_logs[block_start + bb] += (nodes - max_overlap) / 2;
+        }
+      }
+    }
+  }
+
+  // make sure that we have kept track of overlaps correctly
+  for (int pp = 0; pp < pattern_number; pp++) {
+    for (int nn = 0; nn < networks; nn++) {
+      assert(overlaps[pp * networks + nn]
+             == nodes - 2 * __builtin_popcountll(patterns[pp * networks + nn] ^ states[nn]));
+    }
+  }
+
+  if (record) {
+    // bring histograms up to date
+    for (int nn = 0; nn < networks; nn++) {
+      log_energy(nn, records + moves);
+    }
+    // count the moves on which we recorded distances
+    distance_records += ((records + moves + pattern_number - 1) / pattern_number
+                         - (records + pattern_number - 1) / pattern_number);
+    records += moves;
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Writing data files
+// ---------------------------------------------------------------------------------------
+
+void tiny_network_batch::write_energy_file(const string energy_file,
+                                           const string file_header) const {
+  ofstream energy_stream(energy_file);
+  energy_stream << file_header << endl
+                << "# energy, energy histogram" << endl;
+  for (int ee = 0; ee < energy_range; ee++) {
+    if (energy_histogram[ee] == 0) continue;
+    energy_stream << ee + min_energy << " " << energy_histogram[ee] << endl;
+  }
+  energy_stream.close();
+}
+
+void tiny_network_batch::write_distance_file(const string distance_file,
+                                             const string file_header) const {
+  long distance_log = 0;
+  for (int nn = 0; nn < networks; nn++) {
+    distance_log += distance_logs[nn];
+  }
+  ofstream distance_stream(distance_file);
+  distance_stream << file_header << endl
+                  << "# records, distance log " << endl
+                  << distance_records * networks << " " << distance_log << endl;
+  distance_stream.close();
+}
+
+void tiny_network_batch::write_network_file(const string network_file,
+                                            const string file_header) const {
+  ofstream network_stream(network_file);
+  network_stream << file_header << endl
+                 << "# records: " << records << endl
+                 << "# distance records: " << distance_records << endl
+                 << "# network, energy log, squared energy log, distance log" << endl;
+  for (int nn = 0; nn < networks; nn++) {
+    network_stream << setprecision(numeric_limits<double>::max_digits10)
+                   << nn << " "
+                   << energy_logs[nn] << " "
+                   << squared_energy_logs[nn] << " "
+                   << distance_logs[nn] << endl;
+  }
+  network_stream.close();
+}
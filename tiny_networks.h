@@ -0,0 +1,83 @@
+#pragma once
+
+#include <random> // for randomness
+#include <cstdint> // for fixed-width integer types
+
+using namespace std;
+
+// fixed-temperature simulation of many independent tiny networks (of at most 64 nodes),
+//   all of which have the same number of nodes and patterns
+// the state of each network, and each of its patterns, is stored in one machine word
+// rather than storing coupling matrices, we store the couplings of each network in
+//   packed form as its patterns, i.e. J_{ij} = \sum_p x^p_i x^p_j for i != j,
+//   and keep track of the overlaps m_p = \sum_i x^p_i s_i of each network state
+//   with its patterns, in terms of which
+//   the energy of a state is E = -1/2 \sum_p (m_p^2 - nodes), and
+//   the energy change from flipping node i is dE = 2 s_i \sum_p x^p_i m_p - 2 P
+// all data is laid out with networks in the innermost index, and networks are
+//   simulated in blocks which propose to flip the same node on every move, so that
+//   the compiler can vectorize our loops across the networks in a block
+struct tiny_network_batch {
+
+  static const int max_nodes = 64;
+  static const int block_size = 64; // number of networks simulated together
+
+  const int nodes;
+  const int pattern_number;
+  const int networks;
+
+  // the lowest energy that any network can possibly have, and the size of the range of
+  //   energies which networks can possibly have
+  // note: unlike in network_simulation, energies here are "actual" energies
+  const int min_energy;
+  const int energy_range;
+
+  // network patterns, indexed by (pattern, network),
+  //   and network states and energies, indexed by network
+  vector<uint64_t> patterns;
+  vector<uint64_t> states;
+  vector<int> energies;
+
+  // overlaps of network states with their patterns, indexed by (pattern, network)
+  vector<int> overlaps;
+
+  // number of moves (per network) for which we have recorded data
+  long records = 0;
+
+  // histogram containing the number of times we have seen every energy
+  //   in any network, indexed by (energy - min_energy)
+  vector<long> energy_histogram;
+
+  // sum of all (squared) energies seen by each network
+  vector<long> energy_logs;
+  vector<double> squared_energy_logs;
+
+  // the energy histogram and logs are updated lazily: network nn has been at its
+  //   current energy since the record with index energy_since[nn]
+  vector<long> energy_since;
+
+  // number of times we have recorded distance from patterns, and the sum of all
+  //   distances from the nearest pattern seen by each network
+  long distance_records = 0;
+  vector<long> distance_logs;
+
+  // constructor, taking patterns indexed by (network, pattern)
+  //   and initial states indexed by network
+  tiny_network_batch(const vector<vector<vector<bool>>>& network_patterns,
+                     const vector<vector<bool>>& initial_states);
+
+  // add the current energy of a network to histograms and logs once for every record
+  //   since the network arrived at this energy, up to (but not including) a given record
+  void log_energy(const int network, const long record);
+
+  // run for a given number of moves (per network) at a fixed temperature,
+  //   recording data from every move if record is true
+  void run(const long moves, const double input_temp, const bool record,
+           uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // write data files
+  void write_energy_file(const string energy_file, const string file_header) const;
+  void write_distance_file(const string distance_file, const string file_header) const;
+  void write_network_file(const string network_file, const string file_header) const;
+
+};
@@ -0,0 +1,447 @@
+#include <iostream> // for standard output
+#include <iomanip> // for io manipulation (e.g. setw)
+#include <random> // for randomness
+#include <cassert> // for assertions
+#include <algorithm> // for min and max
+#include <thread> // for multithreading
+#include <functional> // for cref
+
+#include "methods.h"
+#include "wang_landau.h"
+
+using namespace std;
+
+constexpr double replica_exchange_wang_landau::window_overlap;
+constexpr double replica_exchange_wang_landau::flatness;
+constexpr double wang_landau_1t::flatness;
+
+// ---------------------------------------------------------------------------------------
+// Wang-Landau walker methods
+// ---------------------------------------------------------------------------------------
+
+// walk from the current state into a given energy window, accepting moves which
+//   bring us farther from the window with a boltzmann probability at temperature temp
+void wang_landau_walker::enter_window(const network_simulation& ns,
+                                      const int lowest, const int highest,
+                                      const double temp) {
+  uniform_real_distribution<double> rnd;
+  auto distance = [&](const int energy) -> int {
+    return max({lowest - energy, energy - highest, 0});
+  };
+  while (distance(energy) > 0) {
+    const int node = floor(rnd(generator) * ns.network.nodes);
+    const int energy_change = ns.node_flip_energy_change(state, node);
+    const int distance_change = distance(energy + energy_change) - distance(energy);
+    if (distance_change <= 0 || rnd(generator) < exp(-distance_change / abs(temp))) {
+      state[node] = !state[node];
+      energy += energy_change;
+    }
+  }
+}
+
+// run for a given number of moves within an energy window
+void wang_landau_walker::run(const network_simulation& ns,
+                             const int lowest, const int highest,
+                             const long moves, const double ln_f) {
+  uniform_real_distribution<double> rnd;
+  for (long mm = 0; mm < moves; mm++) {
+
+    // pick a random node to possibly flip,
+    //   and compute the change in energy from flipping it
+    const int node = floor(rnd(generator) * ns.network.nodes);
+    const int proposed_energy = energy + ns.node_flip_energy_change(state, node);
+
+    // reject all moves out of the window, and otherwise
+    //   accept moves with probability min(1, g(E)/g(E'))
+    if (proposed_energy >= lowest && proposed_energy <= highest) {
+      const double ln_ratio = ln_dos[energy - lowest] - ln_dos[proposed_energy - lowest];
+      if (ln_ratio >= 0 || rnd(generator) < exp(ln_ratio)) {
+        state[node] = !state[node];
+        energy = proposed_energy;
+      }
+    }
+
+    ln_dos[energy - lowest] += ln_f;
+    histogram[energy - lowest]++;
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Energy window methods
+// ---------------------------------------------------------------------------------------
+
+// is the histogram flat, i.e. has every visited energy been seen at least
+//   (flatness) times the mean number of times?
+bool energy_window::flat(const double flatness) const {
+  long total = 0;
+  long min_count = -1;
+  int visited_energies = 0;
+  for (int ee = 0, size = histogram.size(); ee < size; ee++) {
+    if (visits[ee] == 0) continue;
+    total += histogram[ee];
+    visited_energies++;
+    if (min_count < 0 || histogram[ee] < min_count) min_count = histogram[ee];
+  }
+  if (total == 0) return false;
+  return min_count >= flatness * double(total) / visited_energies;
+}
+
+// merge the data of all walkers, and reduce the modification factor
+//   if the merged histogram is flat
+void energy_window::merge_walkers(const double flatness) {
+  const int size = ln_dos.size();
+  const int walker_number = walkers.size();
+  for (int ee = 0; ee < size; ee++) {
+    double ln_dos_sum = 0;
+    for (wang_landau_walker& walker : walkers) {
+      ln_dos_sum += walker.ln_dos[ee];
+      histogram[ee] += walker.histogram[ee];
+      visits[ee] += walker.histogram[ee];
+      walker.histogram[ee] = 0;
+    }
+    ln_dos[ee] = ln_dos_sum / walker_number;
+  }
+  for (wang_landau_walker& walker : walkers) {
+    walker.ln_dos = ln_dos;
+  }
+
+  if (flat(flatness)) {
+    ln_f /= 2;
+    histogram = vector<long>(size, 0);
+    stages++;
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Replica-exchange Wang-Landau methods
+// ---------------------------------------------------------------------------------------
+
+replica_exchange_wang_landau::
+replica_exchange_wang_landau(const network_simulation& ns,
+                             const int lowest, const int highest,
+                             const bool open_below, const bool open_above,
+                             const int window_number, const long seed,
+                             const double final_ln_f, const double temp) :
+  ns(ns),
+  final_ln_f(final_ln_f),
+  seed(seed)
+{
+  assert(window_number > 0);
+  assert(lowest < highest);
+
+  // width of every window, chosen such that neighboring windows overlap
+  //   by window_overlap times this width, and all windows together span
+  //   the energies [lowest, highest]
+  const double width = ((highest - lowest)
+                        / (window_number - (window_number - 1) * window_overlap));
+
+  for (int ww = 0; ww < window_number; ww++) {
+    energy_window window;
+    window.lowest = lowest + round(ww * width * (1 - window_overlap));
+    window.highest = (ww == window_number - 1) ?
+      highest : lowest + round(ww * width * (1 - window_overlap) + width);
+    if (ww == 0 && open_below) window.lowest = 0;
+    if (ww == window_number - 1 && open_above) window.highest = ns.energy_range - 1;
+
+    const int size = window.highest - window.lowest + 1;
+    window.ln_f = 1;
+    window.ln_dos = vector<double>(size, 0);
+    window.histogram = vector<long>(size, 0);
+    window.visits = vector<long>(size, 0);
+    windows.push_back(window);
+  }
+
+  // put one walker into every window
+  for (energy_window& window : windows) {
+    seed_seq walker_seed = { seed, walkers_seeded++ };
+    wang_landau_walker walker = { ns.state, ns.energy(), mt19937_64(walker_seed),
+                                  window.ln_dos, window.histogram };
+    walker.enter_window(ns, window.lowest, window.highest, temp);
+    window.walkers.push_back(walker);
+  }
+
+  exchange_attempts = vector<long>(window_number - 1, 0);
+  exchange_acceptances = vector<long>(window_number - 1, 0);
+}
+
+// have all windows converged?
+bool replica_exchange_wang_landau::converged() const {
+  for (const energy_window& window : windows) {
+    if (window.ln_f >= final_ln_f) return false;
+  }
+  return true;
+}
+
+// run all walkers in windows which have not converged for a given number of moves,
+//   and merge the data of walkers in every window
+void replica_exchange_wang_landau::run(const long moves) {
+  vector<thread> threads;
+  for (energy_window& window : windows) {
+    if (window.ln_f < final_ln_f) continue;
+    for (wang_landau_walker& walker : window.walkers) {
+      threads.push_back(thread(&wang_landau_walker::run, &walker, cref(ns),
+                               window.lowest, window.highest, moves, window.ln_f));
+    }
+  }
+  for (thread& walker_thread : threads) {
+    walker_thread.join();
+  }
+  for (energy_window& window : windows) {
+    if (window.ln_f < final_ln_f) continue;
+    window.merge_walkers(flatness);
+  }
+}
+
+// attempt to exchange states between walkers in neighboring windows
+// an exchange of states with energies E_a and E_b between windows with densities of
+//   states g_a and g_b is accepted with probability
+//   min(1, g_a(E_a) g_b(E_b) / (g_a(E_b) g_b(E_a))),
+//   and only possible if both energies lie in both windows
+void replica_exchange_wang_landau::
+attempt_exchanges(uniform_real_distribution<double>& rnd, mt19937_64& generator) {
+  for (int ww = 0; ww + 1 < int(windows.size()); ww++) {
+    energy_window& window = windows[ww];
+    energy_window& neighbor = windows[ww+1];
+    wang_landau_walker& walker
+      = window.walkers[floor(rnd(generator) * window.walkers.size())];
+    wang_landau_walker& neighbor_walker
+      = neighbor.walkers[floor(rnd(generator) * neighbor.walkers.size())];
+
+    const int energy = walker.energy;
+    const int neighbor_energy = neighbor_walker.energy;
+    exchange_attempts[ww]++;
+    if (energy < neighbor.lowest || energy > neighbor.highest ||
+        neighbor_energy < window.lowest || neighbor_energy > window.highest) continue;
+
+    const double ln_ratio = (window.ln_dos[energy - window.lowest]
+                             - window.ln_dos[neighbor_energy - window.lowest]
+                             + neighbor.ln_dos[neighbor_energy - neighbor.lowest]
+                             - neighbor.ln_dos[energy - neighbor.lowest]);
+    if (ln_ratio >= 0 || rnd(generator) < exp(ln_ratio)) {
+      swap(walker.state, neighbor_walker.state);
+      swap(walker.energy, neighbor_walker.energy);
+      exchange_acceptances[ww]++;
+    }
+  }
+}
+
+// reallocate (a given total number of) walkers between windows, giving more walkers
+//   to windows which require more stages of sampling to converge
+// every window keeps at least one walker (for exchanges), and each additional walker
+//   goes to the window with the most remaining stages per walker
+void replica_exchange_wang_landau::allocate_walkers(const int walker_number) {
+  const int window_number = windows.size();
+  vector<double> remaining_stages(window_number);
+  for (int ww = 0; ww < window_number; ww++) {
+    const double ln_f = windows[ww].ln_f;
+    remaining_stages[ww] = (ln_f < final_ln_f) ? 0 : log2(ln_f / final_ln_f) + 1;
+  }
+
+  vector<int> allocation(window_number, 1);
+  for (int extra = window_number; extra < walker_number; extra++) {
+    int best_window = -1;
+    double most_stages_per_walker = 0;
+    for (int ww = 0; ww < window_number; ww++) {
+      const double stages_per_walker = remaining_stages[ww] / allocation[ww];
+      if (stages_per_walker > most_stages_per_walker) {
+        most_stages_per_walker = stages_per_walker;
+        best_window = ww;
+      }
+    }
+    if (best_window < 0) break;
+    allocation[best_window]++;
+  }
+
+  // new walkers start as copies of an existing walker in the window,
+  //   but with their own random number generator
+  for (int ww = 0; ww < window_number; ww++) {
+    vector<wang_landau_walker>& walkers = windows[ww].walkers;
+    while (int(walkers.size()) > allocation[ww]) {
+      walkers.pop_back();
+    }
+    while (int(walkers.size()) < allocation[ww]) {
+      seed_seq walker_seed = { seed, walkers_seeded++ };
+      wang_landau_walker walker = walkers[walkers.size() - 1];
+      walker.generator.seed(walker_seed);
+      walkers.push_back(walker);
+    }
+  }
+}
+
+// print the status of every window
+void replica_exchange_wang_landau::print_status() const {
+  cout << "window, energies, walkers, stages, ln_f, exchange acceptance rate" << endl;
+  for (int ww = 0, size = windows.size(); ww < size; ww++) {
+    const energy_window& window = windows[ww];
+    cout << ww << " "
+         << window.lowest << "-" << window.highest << " "
+         << window.walkers.size() << " "
+         << window.stages << " "
+         << setprecision(3) << window.ln_f;
+    if (ww + 1 < size) {
+      cout << " " << (exchange_attempts[ww] > 0 ?
+                      double(exchange_acceptances[ww]) / exchange_attempts[ww] : 0);
+    }
+    cout << endl;
+  }
+}
+
+// stitch together the densities of states in all windows, and write the result
+//   (together with the number of visits to every energy) into a simulation object
+// each window is shifted to agree on average with the (already stitched) windows below
+//   it on the energies they have both visited, and takes over above the median of
+//   these energies
+// the result is normalized to match the current density of states in the target
+//   (typically a rough estimate from transition matrix sampling) at the entropy peak
+void replica_exchange_wang_landau::stitch(network_simulation& target) const {
+  vector<double> ln_dos(ns.energy_range, 0);
+  vector<bool> covered(ns.energy_range, false);
+
+  for (const energy_window& window : windows) {
+    vector<int> common_energies;
+    double shift = 0;
+    for (int ee = window.lowest; ee <= window.highest; ee++) {
+      if (covered[ee] && window.visited(ee)) {
+        common_energies.push_back(ee);
+        shift += ln_dos[ee] - window.ln_dos[ee - window.lowest];
+      }
+    }
+    if (!common_energies.empty()) shift /= common_energies.size();
+    const int switch_energy = (common_energies.empty() ? window.lowest :
+                               common_energies[common_energies.size() / 2]);
+
+    for (int ee = switch_energy; ee <= window.highest; ee++) {
+      if (!window.visited(ee)) continue;
+      ln_dos[ee] = window.ln_dos[ee - window.lowest] + shift;
+      covered[ee] = true;
+    }
+  }
+
+  // normalize the stitched density of states to agree with that in the target
+  //   at the entropy peak, or (if we never visited the peak) at its maximum
+  double normalization = target.ln_dos[target.entropy_peak] - ln_dos[target.entropy_peak];
+  if (!covered[target.entropy_peak]) {
+    normalization = -*max_element(ln_dos.begin(), ln_dos.end());
+  }
+
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    if (!covered[ee]) continue;
+    target.ln_dos[ee] = ln_dos[ee] + normalization;
+  }
+  for (const energy_window& window : windows) {
+    for (int ee = window.lowest; ee <= window.highest; ee++) {
+      target.energy_histogram[ee] += window.visits[ee - window.lowest];
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------------------
+// Wang-Landau sampling with the 1/t schedule
+// ---------------------------------------------------------------------------------------
+
+void wang_landau_1t::run(network_simulation& ns, const long run_moves, const double temp,
+                         const bool restrict_to_peak,
+                         uniform_real_distribution<double>& rnd, mt19937_64& generator) {
+  if (histogram.empty()) histogram = vector<long>(ns.energy_range, 0);
+
+  // range of energies we sample
+  int lowest_energy = 0;
+  int highest_energy = ns.energy_range - 1;
+  if (restrict_to_peak) {
+    if (temp > 0) highest_energy = min(ns.entropy_peak + ns.max_de, highest_energy);
+    else lowest_energy = max(ns.entropy_peak - ns.max_de, lowest_energy);
+  }
+
+  int energy = ns.energy();
+
+  // the state we ended the last run with may lie out of the range of energies we now
+  //   sample, and possibly further than any single move can take us, so first walk it
+  //   back into this range (as in wang_landau_walker::enter_window)
+  auto distance = [&](const int energy) -> int {
+    return max({lowest_energy - energy, energy - highest_energy, 0});
+  };
+  while (distance(energy) > 0) {
+    const int node = floor(rnd(generator) * ns.network.nodes);
+    const int energy_change = ns.node_flip_energy_change(node);
+    const int distance_change = distance(energy + energy_change) - distance(energy);
+    if (distance_change <= 0 || rnd(generator) < exp(-distance_change / abs(temp))) {
+      ns.state[node] = !ns.state[node];
+      energy += energy_change;
+    }
+  }
+
+  for (long mm = 0; mm < run_moves; mm++) {
+
+    // pick a random node to possibly flip,
+    //   and compute the change in energy from flipping it
+    const int node = floor(rnd(generator) * ns.network.nodes);
+    const int proposed_energy = energy + ns.node_flip_energy_change(node);
+
+    // reject all moves out of the range of energies we sample, and otherwise
+    //   accept moves with probability min(1, g(E)/g(E'))
+    // when we propose a move into an energy we have never seen, we take the density of
+    //   states at the current energy as our initial guess for its density of states,
+    //   unless we started with an a priori estimate of the density of states
+    const int old_energy = energy;
+    if (proposed_energy >= lowest_energy && proposed_energy <= highest_energy) {
+      if (ns.energy_histogram[proposed_energy] == 0 && ns.ln_dos_estimate.empty()) {
+        ns.ln_dos[proposed_energy] = ns.ln_dos[energy];
+      }
+      const double ln_ratio = ns.ln_dos[energy] - ns.ln_dos[proposed_energy];
+      if (ln_ratio >= 0 || rnd(generator) < exp(ln_ratio)) {
+        ns.state[node] = !ns.state[node];
+        energy = proposed_energy;
+      }
+    }
+
+    // update the density of states and all histograms
+    ns.ln_dos[energy] += ln_f;
+    histogram[energy]++;
+    if (ns.energy_histogram[energy]++ == 0) seen_energies++;
+    ns.update_sample_histogram(energy, old_energy);
+    moves++;
+
+    if (one_over_t) {
+      ln_f = double(seen_energies) / moves;
+      continue;
+    }
+
+    // every [nodes] moves, reduce ln_f if the histogram of visits since the last
+    //   reduction is flat (i.e. every energy we have seen has been visited at least
+    //   [flatness] times the mean number of visits), and switch to the 1/t schedule
+    //   when ln_f < 1/t
+    if (moves % ns.network.nodes != 0) continue;
+    // note: the mean is taken over the energies we have seen within the sampled range,
+    //   as the walker may have visited energies outside it before entering the range
+    long total_visits = 0;
+    long min_visits = -1;
+    int range_energies = 0;
+    for (int ee = lowest_energy; ee <= highest_energy; ee++) {
+      if (ns.energy_histogram[ee] == 0) continue;
+      total_visits += histogram[ee];
+      range_energies++;
+      if (min_visits < 0 || histogram[ee] < min_visits) min_visits = histogram[ee];
+    }
+    if (min_visits >= flatness * double(total_visits) / range_energies) {
+      ln_f /= 2;
+      histogram = vector<long>(ns.energy_range, 0);
+    }
+    if (ln_f < double(seen_energies) / moves) {
+      one_over_t = true;
+      ln_f = double(seen_energies) / moves;
+    }
+  }
+
+  // normalize the density of states to 1 at the entropy peak,
+  //   which we identify among the energies we have seen
+  double max_ln_dos = -numeric_limits<double>::infinity();
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    if (ns.energy_histogram[ee] > 0 && ns.ln_dos[ee] > max_ln_dos) {
+      max_ln_dos = ns.ln_dos[ee];
+      ns.entropy_peak = ee;
+    }
+  }
+  for (int ee = 0; ee < ns.energy_range; ee++) {
+    ns.ln_dos[ee] -= max_ln_dos;
+  }
+}
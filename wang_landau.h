@@ -0,0 +1,164 @@
+#pragma once
+
+#include <random> // for randomness
+
+#include "methods.h"
+
+using namespace std;
+
+// a Wang-Landau walker confined to a window of energies
+// the walker keeps its own estimate of the density of states and its own histogram,
+//   both indexed by (energy - lowest energy in the window),
+//   which are merged with those of other walkers in the same window between runs
+struct wang_landau_walker {
+
+  vector<bool> state;
+  int energy;
+  mt19937_64 generator;
+
+  vector<double> ln_dos;
+  vector<long> histogram;
+
+  // walk from the current state into a given energy window, accepting moves which
+  //   bring us farther from the window with a boltzmann probability at temperature temp
+  void enter_window(const network_simulation& ns, const int lowest, const int highest,
+                    const double temp);
+
+  // run for a given number of moves within an energy window, accepting moves with
+  //   probability min(1, g(E)/g(E')) and multiplying g(E) by exp(ln_f) after every move
+  // note: this method only reads from ns, so walkers can run in concurrent threads
+  void run(const network_simulation& ns, const int lowest, const int highest,
+           const long moves, const double ln_f);
+
+};
+
+// one window of energies [lowest, highest] in replica-exchange Wang-Landau sampling,
+//   with the walkers which explore it
+struct energy_window {
+
+  int lowest;
+  int highest;
+
+  // current (logarithm of the) Wang-Landau modification factor
+  double ln_f;
+
+  // merged density of states and histogram of all walkers in this window
+  //   since the last change of the modification factor,
+  //   as well as the number of visits to every energy in all stages of sampling
+  vector<double> ln_dos;
+  vector<long> histogram;
+  vector<long> visits;
+
+  vector<wang_landau_walker> walkers;
+
+  // number of times we have reduced the modification factor
+  int stages = 0;
+
+  // have we visited an energy in this window at any point?
+  bool visited(const int energy) const { return visits[energy - lowest] > 0; };
+
+  // is the histogram flat, i.e. has every visited energy been seen at least
+  //   (flatness) times the mean number of times?
+  bool flat(const double flatness) const;
+
+  // merge the data of all walkers, and reduce the modification factor
+  //   if the merged histogram is flat
+  void merge_walkers(const double flatness);
+
+};
+
+// replica-exchange Wang-Landau sampling of the density of states in a range of energies,
+//   which is split into overlapping windows explored by walkers in their own threads
+// walkers in neighboring windows periodically attempt to exchange states,
+//   and walkers are reallocated between windows according to how far each window
+//   is from convergence
+struct replica_exchange_wang_landau {
+
+  // fraction of each window which overlaps with its neighbors,
+  //   and histogram flatness criterion
+  static constexpr double window_overlap = 0.5;
+  static constexpr double flatness = 0.8;
+
+  // simulation which provides the network, and into which we stitch together the
+  //   density of states once we are done
+  const network_simulation& ns;
+
+  // we are done when the modification factor in every window falls below this value
+  const double final_ln_f;
+
+  vector<energy_window> windows;
+
+  // seed and counter used to seed the generators of new walkers
+  const long seed;
+  long walkers_seeded = 0;
+
+  // number of exchange attempts and accepted exchanges between windows ww and ww+1
+  vector<long> exchange_attempts;
+  vector<long> exchange_acceptances;
+
+  // constructor: split the energies [lowest, highest] into windows, each with one walker
+  //   to start with; the remaining walkers are allocated adaptively
+  // if open_below (open_above) is true, the lowest (highest) window extends down to
+  //   the lowest (up to the highest) energy in the energy range
+  // walkers start from the current state of ns and walk into their windows at the
+  //   temperature temp
+  replica_exchange_wang_landau(const network_simulation& ns,
+                               const int lowest, const int highest,
+                               const bool open_below, const bool open_above,
+                               const int window_number, const long seed,
+                               const double final_ln_f, const double temp);
+
+  // have all windows converged?
+  bool converged() const;
+
+  // run all walkers in windows which have not converged for a given number of moves,
+  //   and merge the data of walkers in every window
+  void run(const long moves);
+
+  // attempt to exchange states between walkers in neighboring windows
+  void attempt_exchanges(uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+  // reallocate (a given total number of) walkers between windows, giving more walkers
+  //   to windows which require more stages of sampling to converge
+  void allocate_walkers(const int walker_number);
+
+  // print the status of every window
+  void print_status() const;
+
+  // stitch together the densities of states in all windows, and write the result
+  //   (together with the number of visits to every energy) into a simulation object
+  void stitch(network_simulation& target) const;
+
+};
+
+// Wang-Landau sampling of the density of states of a network simulation (which we store
+//   in the ln_dos array of the simulation) with the 1/t schedule of Belardinelli and
+//   Pereyra for the modification factor f: we start with ln_f = 1, and halve it every
+//   time the histogram of visits to all seen energies since the last reduction is flat,
+//   until ln_f falls below 1/t (where t is the number of moves per seen energy),
+//   after which we set ln_f = 1/t
+// while sampling, we also update the energy and sample histograms of the simulation
+struct wang_landau_1t {
+
+  // histogram flatness criterion for reducing ln_f before we switch to the 1/t schedule
+  static constexpr double flatness = 0.8;
+
+  double ln_f = 1;
+  bool one_over_t = false; // have we switched to ln_f = 1/t?
+  long moves = 0;
+
+  // number of distinct energies we have seen
+  int seen_energies = 0;
+
+  // visits to every energy since the last reduction of ln_f
+  vector<long> histogram;
+
+  // run for a given number of moves, after which we normalize the density of states
+  //   and locate the entropy peak
+  // if restrict_to_peak is true, we only sample energies up to (down to) max_de past the
+  //   entropy peak in a positive (negative) temperature simulation
+  void run(network_simulation& ns, const long run_moves, const double temp,
+           const bool restrict_to_peak,
+           uniform_real_distribution<double>& rnd, mt19937_64& generator);
+
+};